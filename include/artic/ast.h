@@ -49,17 +49,15 @@ struct Node : public Cast<Node> {
     /// Location of the node in the source file.
     Loc loc;
 
+    static constexpr size_t no_id = size_t(-1);
+    /// Identifier of the node, unique within its program, or `no_id` if it has none yet.
+    /// Identifiers are given by the emitter, and index its side tables (see `Emitter::def_of`).
+    mutable size_t id = no_id;
+
     /// Type assigned after type inference. Not all nodes are typeable.
     mutable const artic::Type* type = nullptr;
-    /// IR definition assigned after IR emission.
-    mutable const thorin::Def* def = nullptr;
-
-    /// List of attributes associated with the node.
-    Ptr<struct AttrList> attrs;
 
-    Node(const Loc& loc)
-        : loc(loc)
-    {}
+    Node(const Loc& loc);
 
     Node(Node&&) = default;
 
@@ -78,6 +76,7 @@ struct Node : public Cast<Node> {
 
     /// Prints the node on the console, for debugging.
     void dump() const;
+
 };
 
 log::Output& operator << (log::Output&, const Node&);
@@ -86,7 +85,10 @@ log::Output& operator << (log::Output&, const Node&);
 
 /// Base class for all declarations.
 struct Decl : public Node {
-    Decl(const Loc& loc) : Node(loc) {}
+    Decl(const Loc& loc);
+
+    /// List of attributes associated with the declaration.
+    Ptr<struct AttrList> attrs;
 
     /// Set to true if this declaration is at the top level of a module.
     bool is_top_level = false;
@@ -97,14 +99,14 @@ struct Decl : public Node {
 
 /// Base class for types.
 struct Type : public Node {
-    Type(const Loc& loc) : Node(loc) {}
+    Type(const Loc& loc);
 
     bool is_tuple() const;
 };
 
 /// Base class for statements.
 struct Stmt : public Node {
-    Stmt(const Loc& loc) : Node(loc) {}
+    Stmt(const Loc& loc);
 
     /// Returns true if the statement is changes the control-flow.
     virtual bool is_jumping() const = 0;
@@ -116,7 +118,7 @@ struct Stmt : public Node {
 
 /// Base class for expressions.
 struct Expr : public Node {
-    Expr(const Loc& loc) : Node(loc) {}
+    Expr(const Loc& loc);
 
     bool is_tuple() const;
 
@@ -140,7 +142,7 @@ struct IdPtrn;
 
 /// Pattern: An expression which does not need evaluation.
 struct Ptrn : public Node {
-    Ptrn(const Loc& loc) : Node(loc) {}
+    Ptrn(const Loc& loc);
 
     bool is_tuple() const;
 
@@ -180,7 +182,7 @@ struct Path : public Node {
     // Set during name-binding, corresponds to the declaration that
     // is associated with the _first_ element of the path.
     // The rest of the path is resolved during type-checking.
-    ast::NamedDecl* start_decl;
+    ast::NamedDecl* start_decl = nullptr;
 
     // Set during type-checking
     bool is_value = false;
@@ -222,9 +224,7 @@ struct Filter : public Node {
 struct Attr : public Node {
     std::string name;
 
-    Attr(const Loc& loc, std::string&& name)
-        : Node(loc), name(std::move(name))
-    {}
+    Attr(const Loc& loc, std::string&& name);
 
     /// Checks that the attribute is well-formed.
     virtual void check(TypeChecker&, const ast::Node*) = 0;
@@ -247,7 +247,8 @@ struct PathAttr : public Attr {
     void print(Printer&) const override;
 };
 
-/// Attribute with an associated literal.
+/// Attribute with an associated literal. The name is empty for
+/// literals given directly as arguments (e.g `target_clones("avx2")`).
 struct LiteralAttr : public Attr {
     Literal lit;
 
@@ -680,6 +681,7 @@ struct BlockExpr : public Expr {
     BlockExpr(const Loc& loc, PtrVector<Stmt>&& stmts, bool last_semi)
         : Expr(loc), stmts(std::move(stmts)), last_semi(last_semi)
     {}
+    ~BlockExpr();
 
     bool is_jumping() const override;
     bool has_side_effect() const override;
@@ -868,11 +870,23 @@ struct WhileExpr : public LoopExpr {
 /// For loop expression.
 struct ForExpr : public LoopExpr {
     Ptr<CallExpr> call;
+    Ptr<Ptrn> ptrn;
+    Ptr<Expr> from;
+    Ptr<Expr> to;
+    Ptr<Expr> body;
 
+    // Constructor for the iterator form: `for ptrn in iter(args) { body }`
     ForExpr(const Loc& loc, Ptr<CallExpr>&& call)
         : LoopExpr(loc), call(std::move(call))
     {}
 
+    // Constructor for the counted range form: `for ptrn in from..to { body }`
+    ForExpr(const Loc& loc, Ptr<Ptrn>&& ptrn, Ptr<Expr>&& from, Ptr<Expr>&& to, Ptr<Expr>&& body)
+        : LoopExpr(loc), ptrn(std::move(ptrn)), from(std::move(from)), to(std::move(to)), body(std::move(body))
+    {}
+
+    bool is_range() const { return !call; }
+
     bool is_jumping() const override;
     bool has_side_effect() const override;
 
@@ -995,6 +1009,7 @@ struct BinaryExpr : public Expr {
         Ptr<Expr>&& right)
         : Expr(loc), tag(tag), left(std::move(left)), right(std::move(right))
     {}
+    ~BinaryExpr();
 
     bool has_eq() const { return has_eq(tag); }
     bool has_cmp() const { return has_cmp(tag); }
@@ -1406,6 +1421,10 @@ struct ModDecl : public NamedDecl {
 
     std::vector<const NamedDecl*> members;
 
+    /// Number of identifiers given to the nodes of the program (see `Node::id`).
+    /// Only used for the implicitly defined global module.
+    mutable size_t id_count = 0;
+
     /// Constructor for the implicitly defined global module.
     /// When using this constructor, the user is responsible for calling
     /// `set_super()` once the declarations have been added to the module.
@@ -9,6 +9,7 @@
 #include "artic/symbol.h"
 #include "artic/ast.h"
 #include "artic/log.h"
+#include "artic/array.h"
 
 namespace artic {
 
@@ -37,9 +38,10 @@ public:
     ast::ModDecl*  cur_mod;
 
     void bind_head(ast::Decl&);
+    void bind(ast::Decl&);
     void bind(ast::Node&);
 
-    void push_scope(bool top_level = false) { scopes_.emplace_back(top_level); }
+    void push_scope(bool top_level = false) { symbols_.push_scope(top_level); }
     void pop_scope();
     void insert_symbol(ast::NamedDecl&, const std::string&);
     void insert_symbol(ast::NamedDecl& decl) {
@@ -47,37 +49,58 @@ public:
     }
 
     Symbol* find_symbol(const std::string& name) {
-        for (auto it = scopes_.rbegin(); it != scopes_.rend(); it++) {
-            if (auto symbol = it->find(name)) {
-                symbol->use_count++;
-                return symbol;
-            }
-        }
-        return nullptr;
+        auto symbol = symbols_.find(name);
+        if (symbol)
+            symbol->use_count++;
+        return symbol;
     }
 
     Symbol* find_similar_symbol(const std::string& name) {
-        Symbol* best = nullptr;
         auto min = levenshtein_threshold();
-        for (auto it = scopes_.rbegin(); it != scopes_.rend(); it++)
-            best = it->find_similar(name, min, levenshtein);
-        return best;
+        return symbols_.find_similar(name, min, levenshtein);
     }
 
 private:
     // Levenshtein distance is used to suggest similar identifiers to the user
     static constexpr size_t levenshtein_threshold() { return 3; }
-    static size_t levenshtein(const std::string_view& a, const std::string_view& b, size_t max) {
-        if (max == 0 || a.empty() || b.empty())
-            return std::max(a.size(), b.size());
-        auto d = a.front() != b.front() ? 1 : 0;
-        auto d1 = levenshtein(a.substr(1), b, max - 1) + 1;
-        auto d2 = levenshtein(a, b.substr(1), max - 1) + 1;
-        auto d3 = levenshtein(a.substr(1), b.substr(1), max - d) + d;
-        return std::min(d1, std::min(d2, d3));
+    static size_t levenshtein(std::string_view a, std::string_view b, size_t max) {
+        // Computes the distance with a single row of the dynamic programming matrix,
+        // restricted to the band of cells that are at most `max` away from the diagonal.
+        // Any result greater than `max` is reported as `max + 1`.
+        if (a.size() > b.size())
+            std::swap(a, b);
+        auto inf = max + 1;
+        if (b.size() - a.size() > max)
+            return inf;
+        SmallArray<size_t, 32> row(a.size() + 1);
+        for (size_t j = 0; j <= a.size(); ++j)
+            row[j] = std::min(j, inf);
+        for (size_t i = 1; i <= b.size(); ++i) {
+            size_t first = i > max ? i - max : 1;
+            size_t last  = std::min(a.size(), i + max);
+            size_t diag  = row[first - 1];
+            row[first - 1] = first == 1 ? std::min(i, inf) : inf;
+            size_t row_min = row[first - 1];
+            for (size_t j = first; j <= last; ++j) {
+                auto d = std::min({
+                    diag + (a[j - 1] != b[i - 1] ? 1 : 0),
+                    row[j] + 1,
+                    row[j - 1] + 1,
+                    inf });
+                diag = row[j];
+                row[j] = d;
+                row_min = std::min(row_min, d);
+            }
+            if (last < a.size())
+                row[last + 1] = inf;
+            // Stop as soon as no cell of the band is within the bound
+            if (row_min > max)
+                return inf;
+        }
+        return row[a.size()];
     }
 
-    std::vector<SymbolTable> scopes_;
+    SymbolTable symbols_;
 
     friend struct ast::ModDecl;
 };
@@ -20,6 +20,10 @@ public:
 
     TypeTable& type_table;
 
+    /// When set, every node that goes through `check()` or `infer()` is added to this list.
+    /// This is used by the language server to find the node at a given position.
+    std::vector<const ast::Node*>* checked_nodes = nullptr;
+
     /// Performs type checking on a whole program.
     /// Returns true on success, otherwise false.
     bool run(ast::ModDecl&);
@@ -46,6 +50,8 @@ public:
     void invalid_constraint(const Loc&, const TypeVar*, const Type*, const Type*, const Type*);
     void invalid_attr(const Loc&, const std::string_view&);
     void unsized_type(const Loc&, const Type*);
+    void redundant_case(const ast::CaseExpr&);
+    void non_exhaustive_match(const ast::MatchExpr&);
 
     const Type* expect(const Loc&, const Type*, const Type*);
 
@@ -54,7 +60,9 @@ public:
     const Type* try_coerce(Ptr<ast::Expr>&, const Type*);
     const Type* join(Ptr<ast::Expr>&, Ptr<ast::Expr>&);
 
+    const Type* check(ast::Decl&, const Type*);
     const Type* check(ast::Node&, const Type*);
+    const Type* infer(ast::Decl&);
     const Type* infer(ast::Node&);
     const Type* infer(ast::Ptrn&, Ptr<ast::Expr>&);
 
@@ -71,6 +79,7 @@ public:
     bool check_attrs(const ast::NamedAttr&, const ArrayRef<AttrType>&);
     bool check_filter(const ast::Expr&);
     void check_refutability(const ast::Ptrn&, bool);
+    void check_match(const ast::MatchExpr&, const Type*);
 
     template <typename InferElems>
     const Type* infer_array(const Loc&, const std::string_view&, size_t, bool, const InferElems&);
@@ -84,6 +93,10 @@ private:
     std::unordered_set<const ast::Decl*> decls_;
 };
 
+/// Returns the declaration that a path to a value refers to, by following the modules that it goes through.
+/// Returns `nullptr` if the path goes through a declaration that is not a module.
+const ast::NamedDecl* path_decl(TypeTable&, const ast::Path&);
+
 } // namespace artic
 
 #endif // ARTIC_CHECK_H
@@ -0,0 +1,43 @@
+#ifndef ARTIC_CPU_FEATURES_H
+#define ARTIC_CPU_FEATURES_H
+
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace artic {
+
+/// x86 CPU feature for which functions can be cloned with `#[target_clones]`.
+struct CpuFeature {
+    /// Name of the feature, both in the attribute and for LLVM.
+    std::string_view name;
+    /// CPUID leaf (1 or 7) in which the feature bit is reported.
+    uint32_t leaf;
+    /// True if the feature bit is in EBX, false if it is in ECX.
+    bool in_ebx;
+    uint32_t bit;
+    /// Bits of XCR0 that must be set, for features that need the OS to save extended registers.
+    uint32_t xcr0_mask;
+};
+
+static constexpr CpuFeature cpu_features[] = {
+    { "sse4.2",  1, false, 20, 0x00 },
+    { "avx",     1, false, 28, 0x06 },
+    { "fma",     1, false, 12, 0x06 },
+    { "avx2",    7, true,   5, 0x06 },
+    { "bmi2",    7, true,   8, 0x00 },
+    { "avx512f", 7, true,  16, 0xE6 }
+};
+
+/// Returns the index of the given feature in `cpu_features`, or -1 if it is not supported.
+inline int find_cpu_feature(const std::string_view& name) {
+    for (int i = 0, n = std::size(cpu_features); i < n; ++i) {
+        if (cpu_features[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+} // namespace artic
+
+#endif // ARTIC_CPU_FEATURES_H
@@ -1,7 +1,9 @@
 #ifndef ARTIC_EMIT_H
 #define ARTIC_EMIT_H
 
+#include <array>
 #include <string>
+#include <vector>
 #include <cassert>
 
 #include <thorin/debug.h>
@@ -11,6 +13,7 @@
 #include "artic/types.h"
 #include "artic/log.h"
 #include "artic/hash.h"
+#include "artic/source.h"
 
 namespace artic {
 
@@ -25,9 +28,58 @@ public:
 
     thorin::World& world;
 
+    /// Attaches names and source locations to every IR node, not just to declarations.
+    bool debug = true;
+    /// Lowers memory hint (e.g. `prefetch`), bit manipulation (e.g. `clz`) and `fma` built-ins to
+    /// LLVM intrinsics. When this is false, memory hints are dropped and the other built-ins are
+    /// expressed with plain arithmetic or C library calls, so that the IR can be given to the C backend.
+    /// This is false by default, like the corresponding parameter of `compile()`.
+    bool llvm_intrinsics = false;
+    /// Set when the target is x86-64, which allows using inline assembly for
+    /// operations that LLVM cannot express on its own (e.g. 64-bit `mulhi` or `nt_store`).
+    bool x86_64 = false;
+    /// Set when the target is x86, in 32 or 64-bit mode. Dispatchers for `#[target_clones]`
+    /// detect the features of the CPU with `cpuid`, and are therefore only emitted on x86.
+    bool x86 = false;
+    /// Emits exported functions marked with `#[target_clones]` as dispatchers, which call the
+    /// clone for the best feature supported by the CPU. The clones are imported from other modules.
+    bool target_clones = false;
+    /// When not empty, only the clones for this feature are exported (see `target_clones`).
+    std::string target_clone;
+    /// Features for which the dispatchers of this module import clones.
+    std::vector<std::string> clone_features;
+    /// Instruments every function that has a body, and not only those marked with `#[instrument]`.
+    bool instrument_functions = false;
+    /// Passes the value of the time-stamp counter to the hooks of every instrumented function.
+    /// Like `#[instrument(timestamp)]`, this is only supported on x86 targets.
+    bool instrument_timestamps = false;
+    /// Records the size of the emitted IR in statistics, which requires a walk over the whole world.
+    bool stats = false;
+
+    /// Function that calls the instrumentation hooks. The identifier given to the
+    /// hooks is the index of the function in `instrumented_fns`.
+    struct InstrumentedFn {
+        std::string name;
+        Loc loc;
+    };
+    std::vector<InstrumentedFn> instrumented_fns;
+
+    /// Floating-point rewrites that can be enabled with `#[float_rewrites]` (see `float_arithop`).
+    enum FloatRewrite : uint32_t {
+        FuseMulAdd       = 0x01,
+        FoldConstants    = 0x02,
+        Reciprocal       = 0x04,
+        IgnoreZeros      = 0x08,
+        AllFloatRewrites = 0x0F
+    };
+
     struct State {
         const thorin::Def* mem = nullptr;
         thorin::Continuation* cont = nullptr;
+        /// Set of `FloatRewrite` flags for the function being emitted.
+        uint32_t float_rewrites = 0;
+        /// Declaration of the function whose body is being emitted, if any.
+        const ast::FnDecl* fn_decl = nullptr;
     };
 
     struct SavedState {
@@ -93,15 +145,36 @@ public:
     std::unordered_map<const Type*, const thorin::Def*> struct_ctors;
     /// Map from types to their generated comparison function, if any.
     std::unordered_map<const Type*, const thorin::Def*> comparators;
-    /// Vector containing definitions that are generated during monomorphization.
-    std::vector<std::vector<const thorin::Def**>> poly_defs;
+    /// Map from monomorphic types to their mangled names.
+    std::unordered_map<const Type*, std::string> type_names;
+    /// Map from name to external functions imported by built-ins or dispatchers.
+    std::unordered_map<std::string, thorin::Continuation*> imported_fns;
+    /// Function returning the features of the host CPU, used by dispatchers.
+    thorin::Continuation* cpu_features_fn = nullptr;
+    /// IR definitions emitted for AST nodes, indexed by node identifier.
+    std::vector<const thorin::Def*> defs;
+    /// Number of identifiers given to the nodes of the program (see `ast::ModDecl::id_count`).
+    size_t id_count = 0;
+    /// Map from instrumented functions to the continuation that calls the exit hook before returning.
+    std::unordered_map<const ast::FnExpr*, thorin::Continuation*> return_conts;
+    /// Vector containing nodes whose definitions are generated during monomorphization.
+    std::vector<std::vector<const ast::Node*>> poly_defs;
+    /// Functions that are emitted as dispatchers for their clones.
+    std::vector<const ast::FnDecl*> cloned_fns;
+    /// Map from functions to the functions and static variables they refer to (see `check_clones`).
+    std::unordered_map<const ast::FnDecl*, std::vector<const ast::NamedDecl*>> fn_refs;
 
     bool run(const ast::ModDecl&);
 
-    SavedState save_state() { return SavedState(*this); }
+    const thorin::Def*& def_of(const ast::Node& node) {
+        if (node.id == ast::Node::no_id)
+            node.id = id_count++;
+        if (node.id >= defs.size())
+            defs.resize(id_count, nullptr);
+        return defs[node.id];
+    }
 
-    void redundant_case(const ast::CaseExpr&);
-    void non_exhaustive_match(const ast::MatchExpr&);
+    SavedState save_state() { return SavedState(*this); }
 
     thorin::Continuation* basic_block(thorin::Debug = {});
     thorin::Continuation* basic_block_with_mem(thorin::Debug = {});
@@ -129,6 +202,7 @@ public:
     const thorin::Def* addr_of(const thorin::Def*, thorin::Debug = {});
 
     const thorin::Def* no_ret();
+    const thorin::Def* float_arithop(ast::BinaryExpr::Tag, const thorin::Def*, const thorin::Def*, thorin::Debug = {});
     const thorin::Def* down_cast(const thorin::Def*, const Type*, const Type*, thorin::Debug = {});
 
     const thorin::Def* emit(const ast::Node&);
@@ -137,8 +211,27 @@ public:
     const thorin::Def* emit(const ast::Node&, const Literal&);
 
     const thorin::Def* builtin(const ast::FnDecl&, thorin::Continuation*);
+    const thorin::Def* bit_builtin(const ast::FnDecl&, thorin::Continuation*);
+    const thorin::Def* memory_builtin(const ast::FnDecl&, thorin::Continuation*);
+    const thorin::Def* fma(const thorin::Def*, const thorin::Def*, const thorin::Def*);
+    const thorin::Def* x86_64_mulhi(const thorin::Def*, const thorin::Def*, bool);
+    void x86_64_nt_store(const thorin::Def*, const thorin::Def*);
+    const thorin::Def* call_intrinsic(const std::string&, const std::vector<const thorin::Def*>&, const thorin::Type*);
+    void prefetch(const thorin::Def*, const thorin::Def*, const thorin::Def*);
+    thorin::Continuation* imported_fn(const std::string&, const thorin::FnType*, thorin::CC);
+
+    void dispatcher(thorin::Continuation*, const std::vector<std::string>&);
+    void check_clones();
+    thorin::Continuation* cpu_features();
+    std::array<const thorin::Def*, 4> cpuid(uint32_t);
+    thorin::Continuation* instrument(const ast::FnDecl&, thorin::Continuation*, bool);
+    const thorin::Def* timestamp();
     const thorin::Def* comparator(const Loc&, const Type*);
 
+    /// Mangled names longer than this are shortened by replacing their end with a hash.
+    static constexpr size_t max_type_name_length = 128;
+    const std::string& type_name(const Type*);
+
     thorin::Debug debug_info(const ast::NamedDecl&);
     thorin::Debug debug_info(const ast::Node&, const std::string_view& = "");
 
@@ -146,8 +239,35 @@ private:
     const thorin::Def* cast_pointers(const thorin::Def*, const AddrType*, const AddrType*, thorin::Debug);
 };
 
+/// Helper function to parse, bind and type-check a set of files, without generating any IR.
+/// The types of the resulting AST live in the given type table.
+/// Errors are reported in the log, and this function returns true on success.
+bool check(
+    const std::vector<std::string>& file_names,
+    SourceProvider& sources,
+    bool warns_as_errors,
+    bool enable_all_warns,
+    ast::ModDecl& program,
+    TypeTable& type_table,
+    Log& log);
+
 /// Helper function to compile a set of files and generate an AST and a thorin module.
+/// The contents of each file are requested from the source provider right before it is parsed.
+/// When `debug` is false, only declarations are given names and locations in the IR.
+/// When `llvm_intrinsics` is false, the IR does not refer to LLVM intrinsics (see `Emitter`).
 /// Errors are reported in the log, and this function returns true on success.
+bool compile(
+    const std::vector<std::string>& file_names,
+    SourceProvider& sources,
+    bool warns_as_errors,
+    bool enable_all_warns,
+    ast::ModDecl& program,
+    thorin::World& world,
+    Log& log,
+    bool debug = true,
+    bool llvm_intrinsics = false);
+
+/// Helper function to compile a set of files that are already in memory.
 bool compile(
     const std::vector<std::string>& file_names,
     const std::vector<std::string>& file_data,
@@ -155,7 +275,9 @@ bool compile(
     bool enable_all_warns,
     ast::ModDecl& program,
     thorin::World& world,
-    Log& log);
+    Log& log,
+    bool debug = true,
+    bool llvm_intrinsics = false);
 
 } // namespace artic
 
@@ -2,8 +2,10 @@
 #define ARTIC_LEXER_H
 
 #include <unordered_map>
+#include <unordered_set>
 #include <istream>
 #include <string>
+#include <string_view>
 
 #include "artic/log.h"
 #include "artic/token.h"
@@ -37,6 +39,9 @@ public:
 
     Token next();
 
+    /// Returns the name of the file being lexed, shared with all locations emitted by this lexer.
+    const std::shared_ptr<std::string>& file() const { return loc_.file; }
+
 private:
     struct Utf8Char {
         uint8_t bytes[utf8::max_bytes()] = {0, 0, 0, 0};
@@ -46,12 +51,14 @@ private:
     void eat();
     void eat_spaces();
     void eat_comments();
-    Literal parse_literal();
+    Token parse_literal();
 
     void append();
     void append_char();
     bool accept(uint8_t);
 
+    const std::string& intern(const std::string&);
+
     uint8_t peek(size_t i = 0) const { return cur_.bytes[i]; }
     bool eof() const { return stream_.eof(); }
 
@@ -61,6 +68,10 @@ private:
     Utf8Char cur_;
     std::string str_;
 
+    // Storage for token spellings and string literals. Elements of an
+    // `std::unordered_set` never move, so tokens can refer to them directly.
+    std::unordered_set<std::string> strings_;
+
     static std::unordered_map<std::string, Token::Tag> keywords;
 };
 
@@ -2,6 +2,8 @@
 #define ARTIC_LOCATOR_H
 
 #include <unordered_map>
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -14,22 +16,24 @@
 namespace artic {
 
 /// Represents a file in memory and allows access to the data by line and column.
+/// The line table is only built when the file is first queried by the `Locator`.
 struct LocatorInfo {
     std::string_view data;
     std::vector<size_t> lines;
+    std::vector<bool> ascii;
 
     LocatorInfo(std::string_view data)
         : data(data)
-    {
-        setup();
-    }
+    {}
 
     LocatorInfo(LocatorInfo&&) = default;
     LocatorInfo(const LocatorInfo&) = delete;
 
     const char* at(size_t row, size_t col = std::numeric_limits<size_t>::max()) const {
         const char* line = data.data() + lines[row - 1];
-        const char* end  = data.data() + lines[row] - 1;
+        const char* end  = line_end(row);
+        if (ascii[row - 1])
+            return line + std::min(col - 1, size_t(end - line));
         for (size_t i = 0; i < col - 1 && line < end; ++i)
             line = eat(line);
         return line;
@@ -37,7 +41,9 @@ struct LocatorInfo {
 
     size_t line_size(size_t row) const {
         const char* line = data.data() + lines[row - 1];
-        const char* end  = data.data() + lines[row] - 1;
+        const char* end  = line_end(row);
+        if (ascii[row - 1])
+            return end - line;
         size_t size = 0;
         for (; line != end; ++size)
             line = eat(line);
@@ -51,6 +57,11 @@ struct LocatorInfo {
     }
 
 private:
+    const char* line_end(size_t row) const {
+        // The last row is empty when the file ends with a new line, and has no new line to skip
+        return data.data() + std::max(lines[row - 1] + 1, lines[row]) - 1;
+    }
+
     const char* eat(const char* line) const {
         if (!utf8::is_begin(*line))
             return line + 1;
@@ -69,12 +80,23 @@ private:
         if (data.size() >= 3 && utf8::is_bom(reinterpret_cast<const uint8_t*>(data.data())))
             i += 3;
         lines.push_back(i);
-        for (; i < data.size(); ++i) {
-            if (data[i] == '\n')
-                lines.push_back(i + 1);
+        const char* first = data.data();
+        const char* last  = data.data() + data.size();
+        for (const char* line = first + i; line < last;) {
+            auto next = static_cast<const char*>(std::memchr(line, '\n', last - line));
+            auto end = next ? next : last;
+            // Lines without multibyte characters allow direct column lookups
+            ascii.push_back(std::none_of(line, end, [] (char c) { return utf8::is_begin(c); }));
+            if (!next)
+                break;
+            lines.push_back(next + 1 - first);
+            line = next + 1;
         }
         lines.push_back(data.size());
+        ascii.resize(lines.size(), true);
     }
+
+    friend class Locator;
 };
 
 /// This class implements a system to determine the part of the original
@@ -88,7 +110,11 @@ public:
 
     const LocatorInfo* data(const std::string& file) {
         auto it = info.find(file);
-        return it != info.end() ? &it->second : nullptr;
+        if (it == info.end())
+            return nullptr;
+        if (it->second.lines.empty())
+            it->second.setup();
+        return &it->second;
     }
 
     void register_file(const std::string& file, std::string_view data) {
@@ -2,10 +2,15 @@
 #define ARTIC_LOG_H
 
 #include <iostream>
+#include <sstream>
 #include <cstring>
 #include <cassert>
 #include <utility>
 #include <string_view>
+#include <vector>
+#include <tuple>
+#include <atomic>
+#include <functional>
 
 #ifdef COLORIZE
     #ifdef _WIN32
@@ -167,6 +172,22 @@ void format(Output& out, const char* fmt, T&& t, Args&&... args) {
     format(out, strchr(p, '}') + 1, std::forward<Args>(args)...);
 }
 
+/// Captures an argument of a diagnostic, so that it can be formatted later. Plain values are
+/// copied, but other objects may not outlive the diagnostic and are thus rendered immediately.
+template <typename T>
+auto capture(const T& t, bool colorized) {
+    if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_same_v<T, std::string> || std::is_same_v<T, Loc>)
+        return t;
+    else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+        return std::string(std::string_view(t));
+    else {
+        std::ostringstream os;
+        Output out(os, colorized);
+        out << t;
+        return os.str();
+    }
+}
+
 template <typename... Args>
 void error(const char* fmt, Args&&... args) {
     log::format(err, "{}: ", error_style("error"));
@@ -178,22 +199,58 @@ void error(const char* fmt, Args&&... args) {
 
 class Locator;
 
+/// Diagnostic recorded by a `Logger`. Diagnostics are only formatted and rendered, along
+/// with the source code they refer to, when the `Log` is flushed. Notes are recorded
+/// right after the diagnostic they refer to.
+struct Diagnostic {
+    enum Level { Error, Warning, Note };
+    Level level;
+    Loc loc;
+    std::function<void (log::Output&)> format;
+    bool show_source;
+
+    /// Formats the message of the diagnostic, without colors.
+    std::string message() const;
+};
+
 struct Log {
     Log(log::Output& out, Locator* locator = nullptr, size_t errors = 0, size_t warns = 0)
-        : out(out), locator(locator), errors(errors), warns(warns)
+        : out(out), locator(locator), errors(errors), warns(warns), empty_(errors == 0 && warns == 0)
     {}
 
+    ~Log() { flush(); }
+
     bool is_full() const {
         return max_errors > 0 && errors >= max_errors;
     }
 
+    /// Records a diagnostic. This function is lock-free and can be called from several threads.
+    void record(Diagnostic&&);
+    /// Renders all the diagnostics that have been recorded so far.
+    /// This function must not be called concurrently with itself.
+    void flush();
+    /// Flushes the log and prints the number of errors and warnings.
     void print_summary();
+    /// Removes the diagnostics that have been recorded so far and returns them, without rendering them.
+    std::vector<Diagnostic> take_records();
 
     log::Output& out;
     Locator* locator;
     size_t max_errors = 0;
-    size_t errors;
-    size_t warns;
+    std::atomic<size_t> errors;
+    std::atomic<size_t> warns;
+
+private:
+    struct Record {
+        Diagnostic diag;
+        Record* next;
+    };
+
+    void render(const Diagnostic&);
+    void render_source(const Loc&, log::Style, char);
+
+    std::atomic<Record*> records_ = nullptr;
+    bool empty_;
 };
 
 /// Base class for objects that have a log attached to them.
@@ -211,11 +268,9 @@ struct Logger {
     /// Report an error at the given location in a source file.
     template <typename... Args>
     void error(const Loc& loc, const char* fmt, Args&&... args) {
-        if (!log.is_full()) {
-            error(fmt, std::forward<Args>(args)...);
-            diagnostic(loc, log::Style::Red, '^');
-        } else
-            log.errors++, errors++;
+        if (!log.is_full())
+            record(Diagnostic::Error, loc, fmt, std::forward<Args>(args)...);
+        log.errors++, errors++;
     }
 
     /// Report a warning at the given location in a source file.
@@ -223,63 +278,48 @@ struct Logger {
     void warn(const Loc& loc, const char* fmt, Args&&... args) {
         if (warns_as_errors)
             error(loc, fmt, std::forward<Args>(args)...);
-        else if (!log.is_full()) {
-            warn(fmt, std::forward<Args>(args)...);
-            diagnostic(loc, log::Style::Yellow, '^');
-        } else
+        else {
+            if (!log.is_full())
+                record(Diagnostic::Warning, loc, fmt, std::forward<Args>(args)...);
             log.warns++, warns++;
+        }
     }
 
     /// Display a note corresponding to a specific location in a source file.
     template <typename... Args>
     void note(const Loc& loc, const char* fmt, Args&&... args) {
-        if (!log.is_full()) {
-            note(fmt, std::forward<Args>(args)...);
-            diagnostic(loc, log::Style::Cyan, '-');
-        }
+        if (!log.is_full())
+            record(Diagnostic::Note, loc, fmt, std::forward<Args>(args)...);
     }
 
     /// Report an error.
     template <typename... Args>
     void error(const char* fmt, Args&&... args) {
-        if (!log.is_full()) {
-            if (log.errors > 0 || log.warns > 0)
-                log.out.stream << "\n";
-            log::format(log.out, "{}: ", log::style("error", log::Style::Red, log::Style::Bold));
-            log::format(log.out, fmt, std::forward<Args>(args)...);
-            log.out.stream << '\n';
-        }
-        log.errors++, errors++;
+        error(Loc(), fmt, std::forward<Args>(args)...);
     }
 
     /// Report a warning.
     template <typename... Args>
     void warn(const char* fmt, Args&&... args) {
-        if (warns_as_errors)
-            error(fmt, std::forward<Args>(args)...);
-        else {
-            if (!log.is_full()) {
-                if (log.errors > 0 || log.warns > 0)
-                    log.out.stream << "\n";
-                log::format(log.out, "{}: ", log::style("warning", log::Style::Yellow, log::Style::Bold));
-                log::format(log.out, fmt, std::forward<Args>(args)...);
-                log.out.stream << '\n';
-            }
-            log.warns++, warns++;
-        }
+        warn(Loc(), fmt, std::forward<Args>(args)...);
     }
 
     /// Display a note.
     template <typename... Args>
     void note(const char* fmt, Args&&... args) {
-        if (log.is_full()) return;
-        log::format(log.out, "{}: ", log::style("note", log::Style::Cyan, log::Style::Bold));
-        log::format(log.out, fmt, std::forward<Args>(args)...);
-        log.out.stream << '\n';
+        note(Loc(), fmt, std::forward<Args>(args)...);
     }
 
 private:
-    void diagnostic(const Loc&, log::Style, char);
+    template <typename... Args>
+    void record(Diagnostic::Level level, const Loc& loc, const char* fmt, Args&&... args) {
+        // Format strings are literals, and the arguments are captured so that the message
+        // can be formatted when the log is flushed, if ever.
+        auto format = [fmt, args = std::make_tuple(log::capture(args, log.out.colorized)...)] (log::Output& out) {
+            std::apply([&] (auto&... values) { log::format(out, fmt, values...); }, args);
+        };
+        log.record(Diagnostic { level, loc, std::move(format), diagnostics });
+    }
 
 protected:
     ~Logger() {}
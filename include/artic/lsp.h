@@ -0,0 +1,19 @@
+#ifndef ARTIC_LSP_H
+#define ARTIC_LSP_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace artic {
+
+/// Runs a Language Server Protocol server that reads requests from the given input stream,
+/// and writes responses to the given output stream, until the client asks it to exit.
+/// The given files are analyzed along with the documents opened by the client.
+/// Returns the exit code of the process.
+int run_lsp_server(std::istream&, std::ostream&, const std::vector<std::string>& files);
+
+} // namespace artic
+
+#endif // ARTIC_LSP_H
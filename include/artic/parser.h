@@ -116,7 +116,7 @@ private:
         Loc::Pos begin;
 
         Loc operator () () const {
-            return Loc(parser->prev_.file, begin, parser->prev_.end);
+            return Loc(parser->lexer_.file(), begin, parser->prev_);
         }
 
         Tracker(const Parser* parser, const Loc& loc)
@@ -125,7 +125,7 @@ private:
         {}
 
         Tracker(const Parser* parser)
-            : Tracker(parser, parser->ahead().loc())
+            : Tracker(parser, parser->ahead_loc())
         {}
     };
 
@@ -154,10 +154,12 @@ private:
             if (it == tags.end()) {
                 std::string tag_list;
                 for (size_t i = 0; i < N; i++) {
-                    tag_list += '\'' + Token::tag_to_string(tags[i]) + '\'';
+                    tag_list += '\'';
+                    tag_list += Token::tag_to_string(tags[i]);
+                    tag_list += '\'';
                     if (i != N - 1) tag_list += " or ";
                 }
-                error(ahead().loc(), "expected {}, got '{}'", tag_list, ahead().string());
+                error(ahead_loc(), "expected {}, got '{}'", tag_list, ahead().string());
             }
             next();
             return std::distance(it, tags.begin());
@@ -167,7 +169,7 @@ private:
     bool expect(Token::Tag tag) {
         bool res = ahead().tag() == tag;
         if (!res) {
-            error(ahead().loc(), "expected '{}', got '{}'",
+            error(ahead_loc(), "expected '{}', got '{}'",
                 Token::tag_to_string(tag),
                 ahead().string());
         }
@@ -189,22 +191,28 @@ private:
     }
 
     void next() {
-        prev_ = ahead_[0].loc();
-        for (int i = 0; i < max_ahead - 1; i++)
-            ahead_[i] = ahead_[i + 1];
-        ahead_[max_ahead - 1] = lexer_.next();
+        // The lookahead is a ring buffer: the slot of the token
+        // being consumed is refilled with the next token.
+        prev_ = ahead_[first_].end();
+        ahead_[first_] = lexer_.next();
+        first_ = (first_ + 1) % max_ahead;
     }
 
     const Token& ahead(int i = 0) const {
         assert(i < max_ahead);
-        return ahead_[i];
+        return ahead_[(first_ + i) % max_ahead];
+    }
+
+    Loc ahead_loc(int i = 0) const {
+        return Loc(lexer_.file(), ahead(i).begin(), ahead(i).end());
     }
 
     static constexpr int max_ahead = 3;
 
     Token ahead_[max_ahead];
+    int first_ = 0;
     Lexer& lexer_;
-    Loc prev_;
+    Loc::Pos prev_ = { 0, 0 };
 };
 
 } // namespace artic
@@ -0,0 +1,24 @@
+#ifndef ARTIC_SOURCE_H
+#define ARTIC_SOURCE_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace artic {
+
+/// Interface through which the compiler obtains the contents of source files.
+/// Embedders can implement it to compile code that is never written to disk.
+struct SourceProvider {
+    virtual ~SourceProvider() {}
+
+    /// Returns the contents of the given file, or `std::nullopt` if it cannot be read,
+    /// in which case the provider is responsible for reporting the error, preferably in the
+    /// log given to the compiler, so that it is counted along with other errors.
+    /// The data is not copied by the compiler, and must outlive the compiled program.
+    virtual std::optional<std::string_view> read(const std::string& file_name) = 0;
+};
+
+} // namespace artic
+
+#endif // ARTIC_SOURCE_H
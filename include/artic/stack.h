@@ -0,0 +1,38 @@
+#ifndef ARTIC_STACK_H
+#define ARTIC_STACK_H
+
+#include <optional>
+#include <type_traits>
+
+namespace artic {
+
+namespace stack {
+    /// Returns true if the space left on the stack of the current thread is below a safety margin.
+    bool is_low();
+    /// Calls the given function on a new stack segment.
+    void grow(void (*)(void*), void*);
+}
+
+/// Calls the given function, switching to a new stack segment first if the current stack
+/// is almost exhausted. Recursive traversals of the AST go through this function, so
+/// that deeply nested programs do not overflow the native stack. On platforms where
+/// segments are not supported, the function is simply called on the current stack.
+template <typename F>
+auto ensure_stack(F&& f) -> decltype(f()) {
+    using Result = decltype(f());
+    if (!stack::is_low())
+        return f();
+    if constexpr (std::is_void<Result>::value) {
+        auto call = [&] { f(); };
+        stack::grow([] (void* data) { (*static_cast<decltype(call)*>(data))(); }, &call);
+    } else {
+        std::optional<Result> result;
+        auto call = [&] { result.emplace(f()); };
+        stack::grow([] (void* data) { (*static_cast<decltype(call)*>(data))(); }, &call);
+        return std::move(*result);
+    }
+}
+
+} // namespace artic
+
+#endif // ARTIC_STACK_H
@@ -0,0 +1,51 @@
+#ifndef ARTIC_STATS_H
+#define ARTIC_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "artic/log.h"
+
+namespace artic {
+
+/// Named counter that can be updated from any part of the compiler, and
+/// that is printed with `--stats`. Statistics are meant to be declared as
+/// static objects, and register themselves when they are constructed:
+///
+///     static Statistic tokens("lexer", "tokens", "Number of tokens lexed");
+///     ...
+///     ++tokens;
+struct Statistic {
+    const char* group;
+    const char* name;
+    const char* desc;
+
+    Statistic(const char* group, const char* name, const char* desc);
+    Statistic(const Statistic&) = delete;
+
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+    Statistic& operator ++ () { return *this += 1; }
+    Statistic& operator += (uint64_t n) {
+        value_.fetch_add(n, std::memory_order_relaxed);
+        return *this;
+    }
+    /// Records a quantity that is measured rather than counted (e.g. a table size).
+    void set(uint64_t n) { value_.store(n, std::memory_order_relaxed); }
+
+    /// Returns all the registered statistics, sorted by group and name.
+    static std::vector<const Statistic*> all();
+    /// Prints the statistics that have a non-zero value, in a human-readable form.
+    static void print(log::Output&);
+    /// Prints the statistics as a JSON object of the form `{ "group.name": value, ... }`.
+    static void print_json(std::ostream&);
+
+private:
+    std::atomic<uint64_t> value_ { 0 };
+};
+
+} // namespace artic
+
+#endif // ARTIC_STATS_H
@@ -6,6 +6,7 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <cassert>
 
 namespace artic {
 
@@ -22,35 +23,91 @@ struct Symbol {
     {}
 };
 
-/// Table containing a map from symbol name to declaration site.
+/// Table that maps symbol names to declaration sites, following lexical scoping rules.
+/// All visible symbols are stored in a single map, in which every name is associated
+/// with the chain of declarations that shadow each other (the innermost one last).
+/// Scopes only record which names they declare, so that pushing a scope is free and
+/// popping it only touches the names it declares.
 struct SymbolTable {
-    bool top_level;
-    std::unordered_map<std::string, Symbol> symbols;
+    struct Binding {
+        Symbol symbol;
+        size_t scope;
+    };
+    struct Scope {
+        size_t first;
+        bool top_level;
+    };
+    using Entry = std::unordered_map<std::string, std::vector<Binding>>::value_type;
 
-    SymbolTable(bool top_level = false)
-        : top_level(top_level)
-    {}
+    std::unordered_map<std::string, std::vector<Binding>> symbols;
+    std::vector<Scope> scopes;
+    /// Names declared in the current scopes, in declaration order.
+    std::vector<Entry*> declared;
+    /// Entries of the map above, indexed by the length of their name.
+    std::vector<std::vector<Entry*>> by_length;
+
+    void push_scope(bool top_level = false) {
+        scopes.push_back(Scope { declared.size(), top_level });
+    }
+
+    /// Removes the innermost scope, after calling the given function
+    /// on each of the symbols it contains, in declaration order.
+    template <typename F>
+    void pop_scope(F f) {
+        assert(!scopes.empty());
+        auto scope = scopes.back();
+        for (size_t i = scope.first, n = declared.size(); i < n; ++i)
+            f(declared[i]->first, declared[i]->second.back().symbol, scope.top_level);
+        for (size_t i = scope.first, n = declared.size(); i < n; ++i)
+            declared[i]->second.pop_back();
+        declared.resize(scope.first);
+        scopes.pop_back();
+    }
 
     Symbol* find(const std::string& name) {
         auto it = symbols.find(name);
-        return it != symbols.end() ? &it->second : nullptr;
+        return it != symbols.end() && !it->second.empty() ? &it->second.back().symbol : nullptr;
     }
 
+    /// Finds the visible symbol whose name is the closest to the given one, if its distance is lower than `min`.
+    /// The distance function is given a bound and may return any value above it when the distance exceeds it.
     template <typename T, typename DistanceFn>
     Symbol* find_similar(const std::string& name, T& min, DistanceFn distance) {
         Symbol* best = nullptr;
-        for (auto& symbol : symbols) {
-            auto d = distance(symbol.first, name, min);
-            if (d < min) {
-                best = &symbol.second;
-                min  = d;
+        for (size_t i = 0; i < by_length.size() && min > 0; ++i) {
+            // The distance between two strings is at least the difference of their lengths
+            if ((i < name.size() ? name.size() - i : i - name.size()) >= min)
+                continue;
+            for (auto entry : by_length[i]) {
+                if (entry->second.empty())
+                    continue;
+                auto d = distance(entry->first, name, min - 1);
+                if (d < min) {
+                    best = &entry->second.back().symbol;
+                    min  = d;
+                }
             }
         }
         return best;
     }
 
+    /// Inserts a symbol in the innermost scope.
+    /// Returns false if that scope already contains a symbol with the same name.
     bool insert(const std::string& name, Symbol&& symbol) {
-        return symbols.emplace(name, std::move(symbol)).second;
+        assert(!scopes.empty());
+        auto [it, inserted] = symbols.try_emplace(name);
+        if (inserted) {
+            if (by_length.size() <= name.size())
+                by_length.resize(name.size() + 1);
+            by_length[name.size()].push_back(&*it);
+        }
+        auto& chain = it->second;
+        auto scope = scopes.size() - 1;
+        if (!chain.empty() && chain.back().scope == scope)
+            return false;
+        chain.push_back(Binding { std::move(symbol), scope });
+        declared.push_back(&*it);
+        return true;
     }
 };
 
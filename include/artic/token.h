@@ -2,8 +2,11 @@
 #define ARTIC_TOKEN_H
 
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <ostream>
 #include <cassert>
+#include <cstdint>
 
 #include "artic/loc.h"
 
@@ -43,6 +46,7 @@ namespace artic {
     f(LBracket, "[") \
     f(RBracket, "]") \
     f(Dot, ".") \
+    f(DotDot, "..") \
     f(Dots, "...") \
     f(Comma, ",") \
     f(Semi, ";") \
@@ -158,6 +162,9 @@ inline std::ostream& operator << (std::ostream& os, const Literal& lit) {
     }
 }
 
+/// Lexical token. Tokens are trivially copyable: their spelling refers to
+/// storage owned by the lexer (or to a static string for punctuators and
+/// keywords), and literal payloads are only turned into a `Literal` on request.
 struct Token {
 public:
     enum Tag {
@@ -172,54 +179,117 @@ public:
     {}
 
     /// Constructor for regular tokens, taking a string (e.g. for error messages)
-    Token(const Loc& loc, Tag tag, const std::string& str)
-        : loc_(loc), tag_(tag), str_(str)
+    Token(const Loc& loc, Tag tag, std::string_view str)
+        : begin_(loc.begin), end_(loc.end), tag_(tag), str_(str)
     {}
     /// Constructor for regular tokens
     Token(const Loc& loc, Tag tag)
         : Token(loc, tag, tag_to_string(tag))
     {}
 
-    /// Constructor for literal tokens
-    Token(const Loc& loc, const std::string& str, const Literal& lit)
-        : loc_(loc), tag_(Lit), lit_(lit), str_(str)
-    {}
+    /// Constructor for integer literal tokens
+    Token(const Loc& loc, std::string_view str, uint64_t i)
+        : Token(loc, Lit, str)
+    {
+        lit_tag_ = Literal::Integer;
+        integer_ = i;
+    }
+    /// Constructor for floating-point literal tokens
+    Token(const Loc& loc, std::string_view str, double d)
+        : Token(loc, Lit, str)
+    {
+        lit_tag_ = Literal::Double;
+        double_ = d;
+    }
+    /// Constructor for boolean literal tokens
+    Token(const Loc& loc, std::string_view str, bool b)
+        : Token(loc, Lit, str)
+    {
+        lit_tag_ = Literal::Bool;
+        bool_ = b;
+    }
+    /// Constructor for character literal tokens
+    Token(const Loc& loc, std::string_view str, uint8_t c)
+        : Token(loc, Lit, str)
+    {
+        lit_tag_ = Literal::Char;
+        char_ = c;
+    }
+    /// Constructor for string literal tokens (the contents must outlive the token)
+    Token(const Loc& loc, std::string_view str, const std::string* s)
+        : Token(loc, Lit, str)
+    {
+        lit_tag_ = Literal::String;
+        string_ = s;
+    }
 
     /// Constructor for identifiers
-    Token(const Loc& loc, const std::string& str)
-        : loc_(loc), tag_(Id), str_(str)
+    Token(const Loc& loc, std::string_view str)
+        : Token(loc, Id, str)
     {}
 
     Tag tag() const { return tag_; }
-    const Literal& literal() const { assert(is_literal()); return lit_; }
-    const std::string& identifier() const { assert(is_identifier()); return str_; }
-    const std::string& string() const { return str_; }
+    std::string_view identifier() const { assert(is_identifier()); return str_; }
+    std::string_view string() const { return str_; }
+
+    /// Decodes the literal value of this token.
+    Literal literal() const {
+        assert(is_literal());
+        switch (lit_tag_) {
+            case Literal::Integer: return Literal(integer_);
+            case Literal::Double:  return Literal(double_);
+            case Literal::Bool:    return Literal(bool_);
+            case Literal::Char:    return Literal(char_);
+            case Literal::String:  return Literal(*string_);
+            default:
+                assert(false);
+                return Literal();
+        }
+    }
 
     bool is_identifier() const { return tag_ == Id; }
     bool is_literal() const { return tag_ == Lit; }
+    bool is_integer_literal() const { return is_literal() && lit_tag_ == Literal::Integer; }
+    bool is_string_literal()  const { return is_literal() && lit_tag_ == Literal::String; }
 
-    const Loc& loc() const { return loc_; }
+    const Loc::Pos& begin() const { return begin_; }
+    const Loc::Pos& end()   const { return end_; }
 
-    bool operator == (const Token& token) const { return token.loc_ == loc_ && token.str_ == str_; }
-    bool operator != (const Token& token) const { return token.loc_ != loc_ || token.str_ != str_; }
+    bool operator == (const Token& token) const {
+        return
+            token.begin_.row == begin_.row && token.begin_.col == begin_.col &&
+            token.end_.row   == end_.row   && token.end_.col   == end_.col &&
+            token.tag_ == tag_ && token.str_ == str_;
+    }
+    bool operator != (const Token& token) const { return !(*this == token); }
 
-    static std::string tag_to_string(Tag tag) {
+    static constexpr std::string_view tag_to_string(Tag tag) {
         switch (tag) {
 #define TAG(t, str) case t: return str;
             TOKEN_TAGS(TAG)
 #undef TAG
-            default: assert(false);
+            default: break;
         }
-        return std::string();
+        return std::string_view();
     }
 
 private:
-    Loc loc_;
+    Loc::Pos begin_ = { 0, 0 };
+    Loc::Pos end_   = { 0, 0 };
     Tag tag_;
-    Literal lit_;
-    std::string str_;
+    Literal::Tag lit_tag_ = Literal::Integer;
+    std::string_view str_;
+    union {
+        uint64_t integer_ = 0;
+        double   double_;
+        bool     bool_;
+        uint8_t  char_;
+        const std::string* string_;
+    };
 };
 
+static_assert(std::is_trivially_copyable_v<Token>, "tokens must be cheap to copy");
+
 } // namespace artic
 
 #endif // ARTIC_TOKEN_H
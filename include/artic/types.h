@@ -3,6 +3,8 @@
 
 #include <cstddef>
 #include <unordered_set>
+#include <unordered_map>
+#include <memory>
 #include <optional>
 #include <string_view>
 #include <ostream>
@@ -54,6 +56,10 @@ struct TypeBounds {
 /// the same `TypeTable` object.
 struct Type : public Cast<Type> {
     TypeTable& type_table;
+    /// Identifier given by the `TypeTable` in order of creation. Unlike the address
+    /// of the type, it does not change from one run to another: Hashes are built
+    /// from identifiers, so that the layout of hash tables is reproducible.
+    size_t id = 0;
 
     Type(TypeTable& type_table)
         : type_table(type_table)
@@ -364,7 +370,10 @@ struct TypeFromDecl : public Super {
     const Decl& decl;
 
     size_t hash() const override {
-        return fnv::Hash().combine(&decl);
+        return fnv::Hash()
+            .combine(std::string_view(decl.id.name))
+            .combine(decl.loc.begin.row)
+            .combine(decl.loc.begin.col);
     }
 
     bool equals(const Type* other) const override {
@@ -466,6 +475,12 @@ struct ComplexType : public UserType {
     using Type::is_sized;
     size_t order(std::unordered_set<const Type*>&) const override;
     bool is_sized(std::unordered_set<const Type*>&) const override;
+
+private:
+    // Types with few members are searched linearly, the others use
+    // a hash table that is built on the first call to `find_member()`.
+    static constexpr size_t min_indexed_members() { return 16; }
+    mutable std::unique_ptr<std::unordered_map<std::string_view, size_t>> member_index_;
 };
 
 struct StructType : public TypeFromDecl<ComplexType, ast::RecordDecl> {
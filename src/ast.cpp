@@ -3,9 +3,47 @@
 
 #include "artic/ast.h"
 #include "artic/types.h"
+#include "artic/stats.h"
+#include "artic/stack.h"
 
 namespace artic::ast {
 
+static Statistic node_count("ast", "nodes", "Number of AST nodes created");
+static Statistic decl_count("ast", "decls", "Number of declarations created");
+static Statistic type_count("ast", "types", "Number of AST types created");
+static Statistic stmt_count("ast", "stmts", "Number of statements created");
+static Statistic expr_count("ast", "exprs", "Number of expressions created");
+static Statistic ptrn_count("ast", "ptrns", "Number of patterns created");
+static Statistic attr_count("ast", "attrs", "Number of attributes created");
+
+Node::Node(const Loc& loc) : loc(loc) { ++node_count; }
+
+Decl::Decl(const Loc& loc) : Node(loc) { ++decl_count; }
+Type::Type(const Loc& loc) : Node(loc) { ++type_count; }
+Stmt::Stmt(const Loc& loc) : Node(loc) { ++stmt_count; }
+Expr::Expr(const Loc& loc) : Node(loc) { ++expr_count; }
+Ptrn::Ptrn(const Loc& loc) : Node(loc) { ++ptrn_count; }
+
+Attr::Attr(const Loc& loc, std::string&& name)
+    : Node(loc), name(std::move(name))
+{
+    ++attr_count;
+}
+
+// Nested blocks and long chains of operators would
+// otherwise be destroyed recursively, on the native stack.
+BlockExpr::~BlockExpr() {
+    ensure_stack([&] { stmts.clear(); });
+}
+
+BinaryExpr::~BinaryExpr() {
+    while (left && left->isa<BinaryExpr>()) {
+        auto next = std::move(left->as<BinaryExpr>()->left);
+        left = std::move(next);
+    }
+    ensure_stack([&] { right.reset(); });
+}
+
 bool Type::is_tuple() const { return isa<TupleType>(); }
 bool Expr::is_tuple() const { return isa<TupleExpr>(); }
 bool Ptrn::is_tuple() const { return isa<TuplePtrn>(); }
@@ -31,7 +69,7 @@ std::string PrimType::tag_to_string(Tag tag) {
 }
 
 PrimType::Tag PrimType::tag_from_token(const Token& token) {
-    static std::unordered_map<std::string, Tag> tag_map{
+    static std::unordered_map<std::string_view, Tag> tag_map{
         std::make_pair("bool", Bool),
 
         std::make_pair("i8",  I8),
@@ -523,10 +561,14 @@ bool WhileExpr::has_side_effect() const {
 }
 
 bool ForExpr::is_jumping() const {
+    if (is_range())
+        return from->is_jumping() || to->is_jumping();
     return call->is_jumping();
 }
 
 bool ForExpr::has_side_effect() const {
+    if (is_range())
+        return from->has_side_effect() || to->has_side_effect() || body->has_side_effect();
     return call->has_side_effect();
 }
 
@@ -1,5 +1,6 @@
 #include "artic/bind.h"
 #include "artic/ast.h"
+#include "artic/stack.h"
 
 namespace artic {
 
@@ -12,42 +13,46 @@ void NameBinder::bind_head(ast::Decl& decl) {
     decl.bind_head(*this);
 }
 
+void NameBinder::bind(ast::Decl& decl) {
+    if (decl.attrs)
+        decl.attrs->bind(*this);
+    ensure_stack([&] { decl.bind(*this); });
+}
+
 void NameBinder::bind(ast::Node& node) {
-    if (node.attrs)
-        node.attrs->bind(*this);
-    node.bind(*this);
+    ensure_stack([&] { node.bind(*this); });
 }
 
 void NameBinder::pop_scope() {
-    for (auto& pair : scopes_.back().symbols) {
-        auto decl = pair.second.decl;
-        if (pair.second.use_count == 0 &&
-            !scopes_.back().top_level &&
+    symbols_.pop_scope([&] (const std::string& name, const Symbol& symbol, bool top_level) {
+        auto decl = symbol.decl;
+        if (symbol.use_count == 0 &&
+            !top_level &&
             !decl->isa<ast::FieldDecl>() &&
             !decl->isa<ast::OptionDecl>()) {
-            warn(decl->loc, "unused identifier '{}'", pair.first);
+            warn(decl->loc, "unused identifier '{}'", name);
             note("prefix unused identifiers with '_'");
         }
-    }
-    scopes_.pop_back();
+    });
 }
 
 void NameBinder::insert_symbol(ast::NamedDecl& decl, const std::string& name) {
-    assert(!scopes_.empty());
     assert(!name.empty());
 
     // Do not bind anonymous variables
     if (name[0] == '_') return;
 
+    // The shadowed symbol may move when the new one is inserted, so only keep its declaration
     auto shadow_symbol = find_symbol(name);
-    if (!scopes_.back().insert(name, Symbol(&decl))) {
+    auto shadow_decl = shadow_symbol ? shadow_symbol->decl : nullptr;
+    if (!symbols_.insert(name, Symbol(&decl))) {
         error(decl.loc, "identifier '{}' already declared", name);
-        note(shadow_symbol->decl->loc, "previously declared here");
+        note(shadow_decl->loc, "previously declared here");
     } else if (
-        warn_on_shadowing && shadow_symbol &&
-        decl.isa<ast::PtrnDecl>() && !shadow_symbol->decl->is_top_level) {
+        warn_on_shadowing && shadow_decl &&
+        decl.isa<ast::PtrnDecl>() && !shadow_decl->is_top_level) {
         warn(decl.loc, "declaration shadows identifier '{}'", name);
-        note(shadow_symbol->decl->loc, "previously declared here");
+        note(shadow_decl->loc, "previously declared here");
     }
 }
 
@@ -266,6 +271,19 @@ void WhileExpr::bind(NameBinder& binder) {
 }
 
 void ForExpr::bind(NameBinder& binder) {
+    if (is_range()) {
+        binder.bind(*from);
+        binder.bind(*to);
+        binder.push_scope();
+        binder.bind(*ptrn);
+        auto old_loop = binder.cur_loop;
+        binder.cur_loop = this;
+        binder.bind(*body);
+        binder.cur_loop = old_loop;
+        binder.pop_scope();
+        return;
+    }
+
     // The call expression looks like:
     // iterate(|i| { ... })(...)
     // continue() and break() should only be available to the lambda
@@ -273,8 +291,6 @@ void ForExpr::bind(NameBinder& binder) {
     auto old_loop = binder.cur_loop;
     binder.cur_loop = this;
     auto loop_body = call->callee->as<CallExpr>()->arg->as<FnExpr>();
-    if (loop_body->attrs)
-        loop_body->attrs->bind(binder);
     loop_body->bind(binder, true);
     binder.cur_loop = old_loop;
     binder.bind(*call->arg);
@@ -463,14 +479,14 @@ void ModDecl::bind_head(NameBinder& binder) {
 
 void ModDecl::bind(NameBinder& binder) {
     // Symbols defined outside the module are not visible inside it.
-    std::vector<SymbolTable> old_scopes;
-    std::swap(binder.scopes_, old_scopes);
+    SymbolTable old_symbols;
+    std::swap(binder.symbols_, old_symbols);
     auto old_mod = binder.cur_mod;
     binder.cur_mod = this;
     binder.push_scope();
     for (auto& decl : decls) binder.bind_head(*decl);
     for (auto& decl : decls) binder.bind(*decl);
-    std::swap(binder.scopes_, old_scopes);
+    std::swap(binder.symbols_, old_symbols);
     binder.cur_mod = old_mod;
 }
 
@@ -1,6 +1,8 @@
 #include <algorithm>
 
 #include "artic/check.h"
+#include "artic/cpu_features.h"
+#include "artic/stack.h"
 
 namespace artic {
 
@@ -127,6 +129,14 @@ void TypeChecker::unsized_type(const Loc& loc, const Type* type) {
     error(loc, "type '{}' is recursive and not sized", *type);
 }
 
+void TypeChecker::redundant_case(const ast::CaseExpr& case_) {
+    error(case_.loc, "redundant match case");
+}
+
+void TypeChecker::non_exhaustive_match(const ast::MatchExpr& match) {
+    error(match.loc, "non exhaustive match expression");
+}
+
 // Helpers -------------------------------------------------------------------------
 
 const Type* TypeChecker::expect(const Loc& loc, const Type* type, const Type* expected) {
@@ -204,21 +214,40 @@ const Type* TypeChecker::join(Ptr<ast::Expr>& left, Ptr<ast::Expr>& right) {
     return type;
 }
 
+const Type* TypeChecker::check(ast::Decl& decl, const Type* expected) {
+    assert(!decl.type); // Nodes can only be visited once
+    if (checked_nodes)
+        checked_nodes->push_back(&decl);
+    decl.type = ensure_stack([&] { return decl.check(*this, expected); });
+    if (decl.attrs)
+        decl.attrs->check(*this, &decl);
+    return decl.type;
+}
+
 const Type* TypeChecker::check(ast::Node& node, const Type* expected) {
     assert(!node.type); // Nodes can only be visited once
-    node.type = node.check(*this, expected);
-    if (node.attrs)
-        node.attrs->check(*this, &node);
-    return node.type;
+    if (checked_nodes)
+        checked_nodes->push_back(&node);
+    return node.type = ensure_stack([&] { return node.check(*this, expected); });
+}
+
+const Type* TypeChecker::infer(ast::Decl& decl) {
+    if (decl.type)
+        return decl.type;
+    if (checked_nodes)
+        checked_nodes->push_back(&decl);
+    decl.type = ensure_stack([&] { return decl.infer(*this); });
+    if (decl.attrs)
+        decl.attrs->check(*this, &decl);
+    return decl.type;
 }
 
 const Type* TypeChecker::infer(ast::Node& node) {
     if (node.type)
         return node.type;
-    node.type = node.infer(*this);
-    if (node.attrs)
-        node.attrs->check(*this, &node);
-    return node.type;
+    if (checked_nodes)
+        checked_nodes->push_back(&node);
+    return node.type = ensure_stack([&] { return node.infer(*this); });
 }
 
 const Type* TypeChecker::infer(ast::Ptrn& ptrn, Ptr<ast::Expr>& expr) {
@@ -391,6 +420,196 @@ void TypeChecker::check_refutability(const ast::Ptrn& ptrn, bool must_be_trivial
         invalid_ptrn(ptrn.loc, must_be_trivial);
 }
 
+/// Usefulness predicate for pattern matrices, as described in
+/// "Warnings for Pattern Matching", by Luc Maranget.
+class PtrnMatrix {
+public:
+    // Note: `nullptr`s are used to denote row elements that are wildcards
+    using Row = std::vector<const ast::Ptrn*>;
+
+    PtrnMatrix(TypeTable& type_table)
+        : type_table(type_table)
+    {}
+
+    /// Returns true if the given row matches values that are not matched by any
+    /// of the given rows. Columns are processed from last to first, and `types`
+    /// contains the type of each column.
+    bool is_useful(std::vector<Row> rows, Row row, std::vector<const Type*> types) {
+        if (types.empty())
+            return rows.empty();
+
+        auto type = types.back();
+        types.pop_back();
+        for (auto& other : rows)
+            other.back() = strip(other.back());
+        row.back() = strip(row.back());
+
+        // Tuples, structures and arrays only have one constructor: Replace them by their members
+        if (auto member_count = product_size(type)) {
+            for (auto& other : rows)
+                expand(other, *member_count);
+            expand(row, *member_count);
+            for (size_t i = 0; i < *member_count; ++i)
+                types.push_back(member_type(type, i));
+            return is_useful(std::move(rows), std::move(row), std::move(types));
+        }
+
+        if (row.back())
+            return is_useful_ctor(rows, row, types, type, ctor_index(row.back()));
+
+        std::unordered_set<uint64_t> ctors;
+        for (auto& other : rows) {
+            if (other.back())
+                ctors.emplace(ctor_index(other.back()));
+        }
+        if (is_complete(type, ctors.size())) {
+            return std::any_of(ctors.begin(), ctors.end(), [&] (uint64_t ctor) {
+                return is_useful_ctor(rows, row, types, type, ctor);
+            });
+        }
+
+        // Only the rows that start with a wildcard can match the constructors that do not appear in the column
+        std::vector<Row> default_rows;
+        for (auto& other : rows) {
+            if (!other.back()) {
+                default_rows.push_back(other);
+                default_rows.back().pop_back();
+            }
+        }
+        row.pop_back();
+        return is_useful(std::move(default_rows), std::move(row), std::move(types));
+    }
+
+private:
+    TypeTable& type_table;
+    PtrVector<ast::Ptrn> tmp_ptrns;
+
+    static const ast::Ptrn* strip(const ast::Ptrn* ptrn) {
+        while (ptrn) {
+            if (auto typed_ptrn = ptrn->isa<ast::TypedPtrn>())
+                ptrn = typed_ptrn->ptrn.get();
+            else if (auto id_ptrn = ptrn->isa<ast::IdPtrn>())
+                ptrn = id_ptrn->sub_ptrn.get();
+            else if (ptrn->isa<ast::ErrorPtrn>())
+                return nullptr;
+            else
+                break;
+        }
+        return ptrn;
+    }
+
+    static std::optional<size_t> product_size(const Type* type) {
+        if (auto [_, struct_type] = match_app<StructType>(type); struct_type)
+            return struct_type->member_count();
+        else if (auto tuple_type = type->isa<TupleType>())
+            return tuple_type->args.size();
+        else if (auto sized_array_type = type->isa<SizedArrayType>())
+            return sized_array_type->size;
+        return std::nullopt;
+    }
+
+    static bool is_complete(const Type* type, size_t ctor_count) {
+        if (is_bool_type(type))
+            return ctor_count == 2;
+        auto [_, enum_type] = match_app<EnumType>(type);
+        return enum_type && enum_type->member_count() == ctor_count;
+    }
+
+    // Encodes literals and enumeration variants as integers
+    static uint64_t ctor_index(const ast::Ptrn* ptrn) {
+        if (auto ctor_ptrn = ptrn->isa<ast::CtorPtrn>())
+            return ctor_ptrn->variant_index;
+        else if (auto record_ptrn = ptrn->isa<ast::RecordPtrn>())
+            return record_ptrn->variant_index;
+        auto& lit = ptrn->as<ast::LiteralPtrn>()->lit;
+        if (lit.is_bool())
+            return lit.as_bool();
+        else if (lit.is_char())
+            return lit.as_char();
+        return lit.as_integer();
+    }
+
+    bool is_useful_ctor(
+        const std::vector<Row>& rows, const Row& row,
+        std::vector<const Type*> types,
+        const Type* type, uint64_t ctor)
+    {
+        // The argument of an enumeration variant is placed in a new column
+        auto [_, enum_type] = match_app<EnumType>(type);
+        if (enum_type)
+            types.push_back(member_type(type, ctor));
+        auto specialize = [&] (Row row) {
+            auto ptrn = row.back();
+            row.pop_back();
+            if (enum_type) {
+                // Record patterns are expanded with the structure type of the variant
+                auto ctor_ptrn = ptrn ? ptrn->isa<ast::CtorPtrn>() : nullptr;
+                row.push_back(ctor_ptrn ? ctor_ptrn->arg.get() : ptrn);
+            }
+            return row;
+        };
+        std::vector<Row> new_rows;
+        for (auto& other : rows) {
+            if (!other.back() || ctor_index(other.back()) == ctor)
+                new_rows.push_back(specialize(other));
+        }
+        return is_useful(std::move(new_rows), specialize(row), std::move(types));
+    }
+
+    void expand(Row& row, size_t member_count) {
+        auto ptrn = row.back();
+        row.pop_back();
+        auto first = row.size();
+        row.resize(first + member_count, nullptr);
+        if (!ptrn)
+            return;
+        if (auto record_ptrn = ptrn->isa<ast::RecordPtrn>()) {
+            for (auto& field : record_ptrn->fields) {
+                if (!field->is_etc())
+                    row[first + field->index] = field->ptrn.get();
+            }
+        } else if (auto ctor_ptrn = ptrn->isa<ast::CtorPtrn>()) {
+            // This must be a tuple-like structure
+            if (member_count == 1)
+                row[first] = ctor_ptrn->arg.get();
+            else if (member_count > 1) {
+                for (size_t i = 0; i < member_count; ++i)
+                    row[first + i] = ctor_ptrn->arg->as<ast::TuplePtrn>()->args[i].get();
+            }
+        } else if (auto tuple_ptrn = ptrn->isa<ast::TuplePtrn>()) {
+            for (size_t i = 0; i < member_count; ++i)
+                row[first + i] = tuple_ptrn->args[i].get();
+        } else if (auto array_ptrn = ptrn->isa<ast::ArrayPtrn>()) {
+            for (size_t i = 0; i < member_count; ++i)
+                row[first + i] = array_ptrn->elems[i].get();
+        } else if (auto literal_ptrn = ptrn->isa<ast::LiteralPtrn>()) {
+            // This must be a string, which is matched character by character
+            auto& str = literal_ptrn->lit.as_string();
+            assert(str.size() + 1 == member_count);
+            for (size_t i = 0; i < member_count; ++i) {
+                auto char_ptrn = make_ptr<ast::LiteralPtrn>(literal_ptrn->loc, uint8_t(str.c_str()[i]));
+                char_ptrn->type = type_table.prim_type(ast::PrimType::U8);
+                row[first + i] = char_ptrn.get();
+                tmp_ptrns.emplace_back(std::move(char_ptrn));
+            }
+        } else
+            assert(false);
+    }
+};
+
+void TypeChecker::check_match(const ast::MatchExpr& match, const Type* arg_type) {
+    PtrnMatrix matrix(type_table);
+    std::vector<PtrnMatrix::Row> rows;
+    for (auto& case_ : match.cases) {
+        PtrnMatrix::Row row { case_->ptrn.get() };
+        if (!matrix.is_useful(rows, row, { arg_type }))
+            redundant_case(*case_);
+        rows.emplace_back(std::move(row));
+    }
+    if (rows.empty() || matrix.is_useful(std::move(rows), { nullptr }, { arg_type }))
+        non_exhaustive_match(match);
+}
+
 bool TypeChecker::check_attrs(const ast::NamedAttr& named_attr, const ArrayRef<AttrType>& attr_types) {
     std::unordered_map<std::string_view, const ast::Attr*> seen;
     for (auto& attr : named_attr.args) {
@@ -475,13 +694,14 @@ bool TypeChecker::infer_type_args(
 {
     auto bounds = forall_type->body->as<FnType>()->dom->bounds(arg_type);
     auto variance = forall_type->body->as<FnType>()->codom->variance(true);
-    for (auto& bound : bounds) {
-        size_t index = std::find_if(
-            forall_type->decl.type_params->params.begin(),
-            forall_type->decl.type_params->params.end(),
-            [&] (auto& param) { return param->type == bound.first; }) -
-            forall_type->decl.type_params->params.begin();
-        assert(index < forall_type->decl.type_params->params.size());
+    // Type variables are visited in declaration order (and not in the order of the
+    // bounds, which depends on their addresses) so that diagnostics are reproducible.
+    auto& type_params = forall_type->decl.type_params->params;
+    for (size_t index = 0, n = type_params.size(); index < n; ++index) {
+        auto it = bounds.find(type_params[index]->type->as<TypeVar>());
+        if (it == bounds.end())
+            continue;
+        auto& bound = *it;
 
         // Check that the provided arguments are compatible with the computed bounds
         if (type_args[index]) {
@@ -537,12 +757,8 @@ const Type* TypeChecker::infer_record_type(const TypeApp* type_app, const Struct
     // If the structure type comes from an option, return the corresponding enumeration type
     if (auto option_decl = struct_type->decl.isa<ast::OptionDecl>()) {
         auto enum_type = infer(*option_decl->parent)->as<artic::EnumType>();
-        index = std::find_if(
-            option_decl->parent->options.begin(),
-            option_decl->parent->options.end(),
-            [struct_type] (auto& option) { return option->type == struct_type; })
-            - option_decl->parent->options.begin();
-        assert(index < option_decl->parent->options.size());
+        index = *enum_type->find_member(option_decl->id.name);
+        assert(option_decl->parent->options[index]->type == struct_type);
         if (type_app)
             return type_table.type_app(enum_type, type_app->type_args);
         return enum_type;
@@ -550,6 +766,19 @@ const Type* TypeChecker::infer_record_type(const TypeApp* type_app, const Struct
     return type_app ? type_app->as<Type>() : struct_type;
 }
 
+const ast::NamedDecl* path_decl(TypeTable& type_table, const ast::Path& path) {
+    const ast::NamedDecl* decl = path.start_decl;
+    for (size_t i = 1, n = path.elems.size(); decl && i < n; ++i) {
+        auto mod_decl = decl->isa<ast::ModDecl>();
+        if (!mod_decl)
+            return nullptr;
+        decl = path.elems[i].is_super()
+            ? mod_decl->super
+            : &type_table.mod_type(*mod_decl)->member(path.elems[i].index);
+    }
+    return decl;
+}
+
 namespace ast {
 
 const artic::Type* Node::check(TypeChecker& checker, const artic::Type* expected) {
@@ -698,6 +927,76 @@ const artic::Type* Filter::check(TypeChecker& checker, const artic::Type* expect
 
 // Attributes ----------------------------------------------------------------------
 
+/// Returns the types of the parameters of a function that is expected to have the given
+/// number of parameters, or an empty vector if that is not the case.
+static std::vector<const artic::Type*> param_types(const artic::FnType* fn_type, size_t count) {
+    if (count == 1)
+        return { fn_type->dom };
+    auto tuple_type = fn_type->dom->isa<artic::TupleType>();
+    if (!tuple_type || tuple_type->args.size() != count)
+        return {};
+    return std::vector<const artic::Type*>(tuple_type->args.begin(), tuple_type->args.end());
+}
+
+/// Checks that the declaration of a built-in function operating on integers (or
+/// floating-point numbers for `fma`) has the form `fn (T, ..., T) -> T`, where
+/// `T` is either a type variable, or a scalar or simd type of the right kind.
+static bool check_bit_builtin(const artic::FnType* fn_type, const std::string& name, size_t arity) {
+    auto type = fn_type->codom;
+    auto elem_type = is_simd_type(type) ? type->as<artic::SizedArrayType>()->elem : type;
+    if (!elem_type->isa<artic::TypeVar>() && !(name == "fma" ? is_float_type(elem_type) : is_int_type(elem_type)))
+        return false;
+    auto params = param_types(fn_type, arity);
+    return
+        params.size() == arity &&
+        std::all_of(params.begin(), params.end(), [&] (auto param) { return param == type; });
+}
+
+/// Checks that the declaration of a memory hint built-in takes a pointer to
+/// the generic address space, along with the expected remaining parameters.
+static bool check_memory_builtin(TypeChecker& checker, const artic::FnType* fn_type, const std::string& name) {
+    auto params = param_types(fn_type, name == "nt_store" ? 2 : 3);
+    auto ptr_type = !params.empty() ? params[0]->isa<artic::PtrType>() : nullptr;
+    if (!ptr_type || ptr_type->addr_space != 0)
+        return false;
+    if (name == "prefetch") {
+        return
+            params[1] == checker.type_table.prim_type(ast::PrimType::I32) &&
+            params[2] == checker.type_table.prim_type(ast::PrimType::I32) &&
+            is_unit_type(fn_type->codom);
+    }
+    return ptr_type->is_mut && params[1] == ptr_type->pointee && is_unit_type(fn_type->codom);
+}
+
+static void check_builtin_signature(TypeChecker& checker, const FnDecl& fn_decl, const std::string& name) {
+    static const std::unordered_map<std::string, size_t> bit_arities = {
+        { "fma",      3 },
+        { "mulhi",    2 },
+        { "popcount", 1 },
+        { "clz",      1 },
+        { "ctz",      1 },
+        { "bswap",    1 },
+        { "rotl",     2 },
+        { "rotr",     2 }
+    };
+    static const std::unordered_map<std::string, std::string_view> memory_signatures = {
+        { "prefetch", "fn (&T, i32, i32) -> ()" },
+        { "nt_store", "fn (&mut T, T) -> ()" }
+    };
+    auto fn_type = fn_decl.fn->type ? fn_decl.fn->type->isa<artic::FnType>() : nullptr;
+    if (!fn_type)
+        return;
+
+    if (auto it = bit_arities.find(name); it != bit_arities.end() && !check_bit_builtin(fn_type, name, it->second)) {
+        checker.error(fn_decl.loc, "invalid signature for built-in function '{}'", name);
+        checker.note("expected a function taking {} argument(s) of the same {} type as its return type",
+            it->second, name == "fma" ? "floating-point" : "integer");
+    } else if (auto it = memory_signatures.find(name); it != memory_signatures.end() && !check_memory_builtin(checker, fn_type, name)) {
+        checker.error(fn_decl.loc, "invalid signature for built-in function '{}'", name);
+        checker.note("expected a function of the form '{}'", it->second);
+    }
+}
+
 void NamedAttr::check(TypeChecker& checker, const ast::Node* node) {
     if (name == "export" || name == "import") {
         if (auto fn_decl = node->isa<FnDecl>()) {
@@ -733,10 +1032,16 @@ void NamedAttr::check(TypeChecker& checker, const ast::Node* node) {
                                 "sqrt", "cbrt",
                                 "pow", "exp", "exp2",
                                 "log", "log2", "log10",
-                                "isnan", "isfinite"
+                                "isnan", "isfinite",
+                                "fma", "mulhi",
+                                "popcount", "clz", "ctz", "bswap",
+                                "rotl", "rotr",
+                                "prefetch", "nt_store"
                             };
                             if (builtins.count(name) == 0)
                                 checker.error(fn_decl->loc, "unsupported built-in function");
+                            else
+                                check_builtin_signature(checker, *fn_decl, name);
                         } else if (cc != "C" && cc != "device" && cc != "thorin")
                             checker.error(cc_attr->loc, "invalid calling convention '{}'", cc);
                     }
@@ -746,6 +1051,45 @@ void NamedAttr::check(TypeChecker& checker, const ast::Node* node) {
             }
         } else
             checker.error(loc, "attribute '{}' is only valid for function declarations", name);
+    } else if (name == "float_rewrites") {
+        if (!node->isa<FnDecl>())
+            checker.error(loc, "attribute '{}' is only valid for function declarations", name);
+        else {
+            checker.check_attrs(*this, std::array<AttrType, 4> {
+                AttrType { "fma",        AttrType::Other },
+                AttrType { "fold",       AttrType::Other },
+                AttrType { "reciprocal", AttrType::Other },
+                AttrType { "zero",       AttrType::Other }
+            });
+        }
+    } else if (name == "instrument") {
+        auto fn_decl = node->isa<FnDecl>();
+        if (!fn_decl)
+            checker.error(loc, "attribute '{}' is only valid for function declarations", name);
+        else if (!fn_decl->fn->body)
+            checker.error(fn_decl->loc, "instrumented functions must have a body");
+        else
+            checker.check_attrs(*this, std::array<AttrType, 1> { AttrType { "timestamp", AttrType::Other } });
+    } else if (name == "target_clones") {
+        auto fn_decl = node->isa<FnDecl>();
+        if (!fn_decl || !fn_decl->attrs->find("export"))
+            checker.error(loc, "attribute '{}' is only valid for exported functions", name);
+        else if (args.empty())
+            checker.error(loc, "attribute '{}' expects a list of CPU features", name);
+        std::unordered_set<std::string> features;
+        for (auto& arg : args) {
+            auto literal_attr = arg->isa<LiteralAttr>();
+            if (!literal_attr || !literal_attr->name.empty() || !literal_attr->lit.is_string())
+                checker.error(arg->loc, "CPU feature name expected");
+            else if (auto& feature = literal_attr->lit.as_string(); find_cpu_feature(feature) < 0) {
+                checker.error(arg->loc, "unsupported CPU feature '{}'", feature);
+                std::string supported;
+                for (auto& cpu_feature : cpu_features)
+                    supported += (supported.empty() ? "'" : ", '") + std::string(cpu_feature.name) + "'";
+                checker.note("supported features are {}", supported);
+            } else if (!features.insert(feature).second)
+                checker.error(arg->loc, "duplicate CPU feature '{}'", feature);
+        }
     } else
         checker.invalid_attr(loc, name);
 }
@@ -980,15 +1324,53 @@ static inline PathExpr* callee_path(Expr* expr) {
     return expr->isa<PathExpr>();
 }
 
+/// Returns the name of the built-in function that the given declaration imports, if any.
+static std::string_view builtin_name(const NamedDecl* decl) {
+    auto import_attr = decl->attrs ? decl->attrs->find("import") : nullptr;
+    auto cc_attr = import_attr ? import_attr->find("cc") : nullptr;
+    auto is_string = [] (const Attr* attr) {
+        return attr && attr->isa<LiteralAttr>() && attr->as<LiteralAttr>()->lit.is_string();
+    };
+    if (!is_string(cc_attr) || cc_attr->as<LiteralAttr>()->lit.as_string() != "builtin")
+        return {};
+    if (auto name_attr = import_attr->find("name"); is_string(name_attr))
+        return name_attr->as<LiteralAttr>()->lit.as_string();
+    return decl->id.name;
+}
+
+static void check_immediate(TypeChecker& checker, const Expr& expr, const std::string_view& what, uint64_t max) {
+    auto literal_expr = expr.isa<LiteralExpr>();
+    if (!literal_expr || !literal_expr->lit.is_integer() || literal_expr->lit.as_integer() > max)
+        checker.error(expr.loc, "{} of 'prefetch' must be an integer literal between 0 and {}", what, max);
+}
+
+/// Checks the arguments of calls to built-ins that LLVM requires to be immediate values.
+static void check_builtin_call(TypeChecker& checker, const CallExpr& call_expr, const Path& path) {
+    auto decl = path_decl(checker.type_table, path);
+    if (!decl || builtin_name(decl) != "prefetch")
+        return;
+    // Signatures are checked on the declaration of the built-in
+    auto tuple_expr = call_expr.arg->isa<TupleExpr>();
+    if (!tuple_expr || tuple_expr->args.size() != 3)
+        return;
+    check_immediate(checker, *tuple_expr->args[1], "access type", 1);
+    check_immediate(checker, *tuple_expr->args[2], "locality", 3);
+}
+
 const artic::Type* CallExpr::infer(TypeChecker& checker) {
     // Perform type argument inference when possible
-    if (auto path_expr = callee_path(callee.get()))
+    if (auto path_expr = callee_path(callee.get())) {
+        if (checker.checked_nodes)
+            checker.checked_nodes->push_back(path_expr);
         path_expr->type = path_expr->path.infer(checker, true, &arg);
+    }
 
     auto [ref_type, callee_type] = remove_ref(checker.infer(*callee));
     if (auto fn_type = callee_type->isa<artic::FnType>()) {
         checker.coerce(callee, fn_type);
         checker.coerce(arg, fn_type->dom);
+        if (auto path_expr = callee_path(callee.get()))
+            check_builtin_call(checker, *this, path_expr->path);
         return fn_type->codom;
     } else {
         // Accept pointers to arrays
@@ -1143,10 +1525,16 @@ const artic::Type* MatchExpr::infer(TypeChecker& checker) {
 const artic::Type* MatchExpr::check(TypeChecker& checker, const artic::Type* expected) {
     auto arg_type = checker.deref(arg);
     const artic::Type* type = expected;
+    bool valid_ptrns = true;
     for (auto& case_ : cases) {
+        auto errors = checker.errors;
         checker.check(*case_->ptrn, arg_type);
+        valid_ptrns &= checker.errors == errors;
         type = type ? checker.coerce(case_->expr, type) : checker.deref(case_->expr);
     }
+    // Exhaustiveness cannot be analyzed if the patterns contain errors
+    if (valid_ptrns && checker.should_report_error(arg_type))
+        checker.check_match(*this, arg_type);
     return type ? type : checker.cannot_infer(loc, "match expression");
 }
 
@@ -1162,14 +1550,27 @@ const artic::Type* WhileExpr::infer(TypeChecker& checker) {
 }
 
 const artic::Type* ForExpr::infer(TypeChecker& checker) {
+    if (is_range()) {
+        // Bounds take the type of the other bound if they are untyped literals, as in `0..n`
+        auto& bound = is_untyped_int_or_float_literal(from.get()) ? to : from;
+        auto& other = &bound == &from ? to : from;
+        auto type = checker.deref(bound);
+        if (!is_int_type(type))
+            type = checker.type_expected(bound->loc, type, "integer");
+        checker.coerce(other, type);
+        checker.check(*ptrn, type);
+        checker.check_refutability(*ptrn, true);
+        return checker.coerce(body, checker.type_table.unit_type());
+    }
     return checker.infer(*call);
 }
 
 const artic::Type* BreakExpr::infer(TypeChecker& checker) {
     const artic::Type* domain = nullptr;
-    if (loop->isa<WhileExpr>())
+    auto for_ = loop->isa<ForExpr>();
+    if (loop->isa<WhileExpr>() || (for_ && for_->is_range()))
         domain = checker.type_table.unit_type();
-    else if (auto for_ = loop->isa<ForExpr>()) {
+    else if (for_) {
         auto type = for_->call->callee->as<CallExpr>()->callee->type;
         if (type && type->isa<artic::FnType>()) {
             // The type of `break` is a continuation that takes as parameter
@@ -1187,9 +1588,10 @@ const artic::Type* BreakExpr::infer(TypeChecker& checker) {
 
 const artic::Type* ContinueExpr::infer(TypeChecker& checker) {
     const artic::Type* domain = nullptr;
-    if (loop->isa<WhileExpr>())
+    auto for_ = loop->isa<ForExpr>();
+    if (loop->isa<WhileExpr>() || (for_ && for_->is_range()))
         domain = checker.type_table.unit_type();
-    else if (auto for_ = loop->isa<ForExpr>()) {
+    else if (for_) {
         auto type = for_->call->callee->as<CallExpr>()->callee->type;
         if (type && type->isa<artic::FnType>()) {
             // The type of `continue` is a continuation that takes as parameter
@@ -1303,9 +1705,15 @@ inline bool is_untyped(const Expr& expr) {
     // Returns true if the given expression is untyped.
     // This allows detection of inference of expressions such as `(2 * 4) + x`, where
     // the type of the left hand side cannot be inferred on its own without knowing the type of `x`.
-    if (auto binary_expr = expr.isa<BinaryExpr>(); binary_expr && !binary_expr->has_eq())
-        return is_untyped(*binary_expr->left) && is_untyped(*binary_expr->right);
-    return is_untyped_int_or_float_literal(&expr);
+    // Operands are tested right to left, so that long chains like `x + y + ... + z` are rejected
+    // immediately instead of being walked entirely for every operator.
+    auto cur = &expr;
+    while (auto binary_expr = cur->isa<BinaryExpr>()) {
+        if (binary_expr->has_eq() || !is_untyped(*binary_expr->right))
+            return false;
+        cur = binary_expr->left.get();
+    }
+    return is_untyped_int_or_float_literal(cur);
 }
 
 const artic::Type* BinaryExpr::infer(TypeChecker& checker) {
@@ -6,6 +6,9 @@
 #include "artic/parser.h"
 #include "artic/bind.h"
 #include "artic/check.h"
+#include "artic/cpu_features.h"
+#include "artic/stats.h"
+#include "artic/stack.h"
 
 #include <thorin/def.h>
 #include <thorin/type.h>
@@ -13,6 +16,14 @@
 
 namespace artic {
 
+static Statistic ptrn_matrices     ("emit", "ptrn_matrices", "Number of pattern matrices compiled");
+static Statistic comparator_count  ("emit", "comparators",   "Number of comparison functions generated");
+static Statistic mono_fn_count     ("emit", "mono_fns",      "Number of instantiations of polymorphic functions");
+static Statistic mono_fns_load     ("emit", "mono_fns_load", "Load factor of the table of instantiations (in percent)");
+static Statistic continuation_count("emit", "continuations", "Number of Thorin continuations emitted");
+static Statistic primop_count      ("emit", "primops",       "Number of Thorin primops emitted");
+static Statistic type_count        ("emit", "types",         "Number of types converted to Thorin types");
+
 /// Pattern matching compiler inspired from
 /// "Compiling Pattern Matching to Good Decision Trees",
 /// by Luc Maranget.
@@ -23,7 +34,6 @@ public:
         const ast::Expr* expr;
         const ast::Node* node;
 
-        bool is_redundant = true;
         thorin::Continuation* cont = nullptr;
         const thorin::Continuation* target;
         std::vector<const struct ast::IdPtrn*> bound_ptrns;
@@ -78,7 +88,9 @@ private:
         , rows(std::move(rows))
         , values(std::move(values))
         , matched_values(matched_values)
-    {}
+    {
+        ++ptrn_matrices;
+    }
 
     static bool is_wildcard(const ast::Ptrn* ptrn) {
         return !ptrn || ptrn->isa<ast::IdPtrn>();
@@ -228,8 +240,10 @@ private:
     }
 
     void compile() {
+        // Non-exhaustive matches are rejected by the type checker, so this only
+        // happens when the checker and the pattern compiler disagree.
         if (rows.empty())
-            return emitter.non_exhaustive_match(*node.as<ast::MatchExpr>());
+            return emitter.error(node.loc, "non exhaustive match expression reached the pattern compiler");
 
         expand();
         if (std::all_of(
@@ -240,7 +254,6 @@ private:
                 }))
         {
             // If the first row is made of only wildcards, it is a match
-            rows.front().second->is_redundant = false;
             for (size_t i = 0, n = rows.front().first.size(); i < n; ++i) {
                 auto ptrn = rows.front().first[i];
                 // Emit names that are bound in this row
@@ -263,8 +276,11 @@ private:
             assert(row.first.size() == values.size());
 #endif
 
-        // Map from constructor index (e.g. literal or enumeration option index, encoded as an integer) to row.
-        std::unordered_map<const thorin::Def*, std::vector<Row>> ctors;
+        // Constructor index (e.g. literal or enumeration option index, encoded as an integer) and rows,
+        // in order of appearance: Iterating over a map indexed by the address of the constructor index
+        // would make the order of the cases in the generated code vary from one run to another.
+        std::vector<std::pair<const thorin::Def*, std::vector<Row>>> ctors;
+        std::unordered_map<const thorin::Def*, size_t> ctor_positions;
         std::vector<Row> wildcards;
 
         auto col = pick_col();
@@ -273,8 +289,11 @@ private:
 
         // First, collect constructors
         for (auto& row : rows) {
-            if (!is_wildcard(row.first[col]))
-                ctors.emplace(emitter.ctor_index(*row.first[col]), std::vector<Row>());
+            if (!is_wildcard(row.first[col])) {
+                auto ctor_index = emitter.ctor_index(*row.first[col]);
+                if (ctor_positions.emplace(ctor_index, ctors.size()).second)
+                    ctors.emplace_back(ctor_index, std::vector<Row>());
+            }
         }
 
         // Then, build the new rows for each constructor case
@@ -304,7 +323,7 @@ private:
                     // the record pattern will be expanded in the next iteration.
                     row.first.push_back(record_ptrn);
                 }
-                ctors[emitter.ctor_index(*ptrn)].emplace_back(std::move(row));
+                ctors[ctor_positions[emitter.ctor_index(*ptrn)]].second.emplace_back(std::move(row));
             }
         }
 
@@ -353,7 +372,7 @@ private:
             remove_col(values, col);
 
             for (size_t i = 0, n = targets.size(); i < n; ++i) {
-                auto& rows = ctors[defs[i]];
+                auto& rows = ctors[i].second;
                 auto _ = emitter.save_state();
                 emitter.enter(i == n - 1 && no_default ? otherwise : targets[i]);
 
@@ -409,12 +428,7 @@ void PtrnCompiler::emit(
         rows.emplace_back(std::vector<const ast::Ptrn*>{ case_.ptrn }, &case_);
 
     std::vector<PtrnCompiler::Value> values = { { emitter.emit(expr), expr.type } };
-    auto compiler = PtrnCompiler(emitter, node, expr, std::move(rows), std::move(values), matched_values);
-    compiler.compile();
-    for (auto &row : compiler.rows) {
-        if (row.second->is_redundant)
-            compiler.emitter.redundant_case(*row.second->node->as<ast::CaseExpr>());
-    }
+    PtrnCompiler(emitter, node, expr, std::move(rows), std::move(values), matched_values).compile();
 }
 
 // Since this code is used for debugging only, it makes sense to hide it in
@@ -454,7 +468,24 @@ void PtrnCompiler::dump() const {
 #endif // GCOV_EXCL_STOP
 
 bool Emitter::run(const ast::ModDecl& mod) {
+    if (instrument_timestamps && !x86) {
+        error("time-stamp instrumentation is only supported on x86 targets");
+        return false;
+    }
+    // Nodes keep their identifiers, so that other emitters for the same program (e.g. for
+    // clones) can size their tables once, and only number the nodes they create themselves.
+    id_count = std::max(id_count, mod.id_count);
+    defs.resize(id_count, nullptr);
     mod.emit(*this);
+    mod.id_count = id_count;
+    check_clones();
+    if (stats) {
+        mono_fns_load.set(static_cast<uint64_t>(mono_fns.load_factor() * 100));
+        continuation_count += world.continuations().size();
+        for (auto def : world.defs())
+            primop_count += def->isa<thorin::PrimOp>() ? 1 : 0;
+        type_count += types.size();
+    }
     return errors == 0;
 }
 
@@ -482,14 +513,6 @@ const thorin::Def* Emitter::ctor_index(size_t index, thorin::Debug debug) {
     return world.literal_qu64(index, debug);
 }
 
-void Emitter::redundant_case(const ast::CaseExpr& case_) {
-    error(case_.loc, "redundant match case");
-}
-
-void Emitter::non_exhaustive_match(const ast::MatchExpr& match) {
-    error(match.loc, "non exhaustive match expression");
-}
-
 const thorin::FnType* Emitter::continuation_type_with_mem(const thorin::Type* from) {
     if (auto tuple_type = from->isa<thorin::TupleType>()) {
         thorin::Array<const thorin::Type*> types(1 + tuple_type->num_ops());
@@ -659,6 +682,63 @@ const thorin::Def* Emitter::no_ret() {
     return world.bottom(world.unit());
 }
 
+const thorin::Def* Emitter::float_arithop(ast::BinaryExpr::Tag tag, const thorin::Def* lhs, const thorin::Def* rhs, thorin::Debug debug) {
+    // Thorin cannot attach fast-math flags to operations, so these rewrites are the only
+    // floating-point relaxations: LLVM still sees strict IEEE operations, which it does not
+    // reorder (e.g. to vectorize reductions).
+    auto zero = world.zero(lhs->type());
+    auto is_constant = [] (const thorin::Def* def) { return def->isa<thorin::PrimLit>() != nullptr; };
+    auto fold = [&] (thorin::ArithOpTag op) -> const thorin::Def* {
+        // (x op c1) op c2 => x op (c1 op c2)
+        if (!(state.float_rewrites & FoldConstants) || !is_constant(rhs))
+            return nullptr;
+        auto arithop = lhs->isa<thorin::ArithOp>();
+        if (!arithop || arithop->arithop_tag() != op || !is_constant(arithop->rhs()))
+            return nullptr;
+        return world.arithop(op, arithop->lhs(), world.arithop(op, arithop->rhs(), rhs), debug);
+    };
+    auto is_mul = [] (const thorin::Def* def) -> const thorin::ArithOp* {
+        auto arithop = def->isa<thorin::ArithOp>();
+        return arithop && arithop->arithop_tag() == thorin::ArithOp_mul ? arithop : nullptr;
+    };
+    switch (tag) {
+        case ast::BinaryExpr::Add:
+            // x + 0 => x, which ignores the sign of zero
+            if (state.float_rewrites & IgnoreZeros) {
+                if (rhs == zero) return lhs;
+                if (lhs == zero) return rhs;
+            }
+            if (auto res = fold(thorin::ArithOp_add))
+                return res;
+            // a * b + c => fma(a, b, c), only when the fused operation is a single instruction
+            if ((state.float_rewrites & FuseMulAdd) && llvm_intrinsics) {
+                if (auto mul = is_mul(lhs)) return fma(mul->lhs(), mul->rhs(), rhs);
+                if (auto mul = is_mul(rhs)) return fma(mul->lhs(), mul->rhs(), lhs);
+            }
+            return world.arithop_add(lhs, rhs, debug);
+        case ast::BinaryExpr::Sub:
+            // x - x => 0, which assumes that x is finite
+            if ((state.float_rewrites & IgnoreZeros) && lhs == rhs)
+                return zero;
+            return world.arithop_sub(lhs, rhs, debug);
+        case ast::BinaryExpr::Mul:
+            // x * 0 => 0, which assumes that x is finite and ignores the sign of zero
+            if ((state.float_rewrites & IgnoreZeros) && (lhs == zero || rhs == zero))
+                return zero;
+            if (auto res = fold(thorin::ArithOp_mul))
+                return res;
+            return world.arithop_mul(lhs, rhs, debug);
+        case ast::BinaryExpr::Div:
+            // x / c => x * (1 / c), where the reciprocal is folded by Thorin
+            if ((state.float_rewrites & Reciprocal) && is_constant(rhs))
+                return world.arithop_mul(lhs, world.arithop_div(world.one(rhs->type()), rhs), debug);
+            return world.arithop_div(lhs, rhs, debug);
+        default:
+            assert(false);
+            return nullptr;
+    }
+}
+
 static inline bool is_compatible(const Type* from, const Type* to) {
     // This function allows casting &[&[i32 * 4] * 5] directly to `&[&[i32]]`,
     // without loading the pointer and extracting each individual elements.
@@ -750,27 +830,30 @@ const thorin::Def* Emitter::down_cast(const thorin::Def* def, const Type* from,
 }
 
 const thorin::Def* Emitter::emit(const ast::Node& node) {
-    if (node.def)
-        return node.def;
+    if (auto def = def_of(node))
+        return def;
     if (!poly_defs.empty())
-        poly_defs.back().push_back(&node.def);
-    return node.def = node.emit(*this);
+        poly_defs.back().push_back(&node);
+    // The table may grow while the node is emitted, so the entry is looked up again
+    auto def = ensure_stack([&] { return node.emit(*this); });
+    def_of(node) = def;
+    return def;
 }
 
 void Emitter::emit(const ast::Ptrn& ptrn, const thorin::Def* value) {
-    assert(!ptrn.def);
-    ptrn.emit(*this, value);
+    assert(!def_of(ptrn));
+    ensure_stack([&] { ptrn.emit(*this, value); });
 }
 
 void Emitter::bind(const ast::IdPtrn& id_ptrn, const thorin::Def* value) {
     if (id_ptrn.decl->is_mut) {
         auto ptr = alloc(value->type(), debug_info(*id_ptrn.decl));
         store(ptr, value);
-        id_ptrn.decl->def = ptr;
+        def_of(*id_ptrn.decl) = ptr;
         if (!id_ptrn.decl->written_to)
             warn(id_ptrn.loc, "mutable variable '{}' is never written to", id_ptrn.decl->id.name);
     } else {
-        id_ptrn.decl->def = value;
+        def_of(*id_ptrn.decl) = value;
         value->set_name(id_ptrn.decl->id.name);
     }
     assert(id_ptrn.type->convert(*this) == value->type());
@@ -876,6 +959,145 @@ static inline const thorin::Def* isfinite(const thorin::Def* val) {
     return world.cmp_ne(exponent, exponent_mask); // The exponent must not be all 1s
 }
 
+/// Returns the suffix that LLVM uses to name the overloads of an intrinsic for the given type (e.g. `v4i32`).
+static inline std::string intrinsic_suffix(const thorin::Type* type, bool is_float) {
+    auto prim_type = type->as<thorin::PrimType>();
+    auto suffix = (is_float ? "f" : "i") + std::to_string(num_bits(prim_type->primtype_tag()));
+    return prim_type->length() > 1 ? "v" + std::to_string(prim_type->length()) + suffix : suffix;
+}
+
+// Note: The following functions operate on unsigned integers, so that right shifts are always
+// logical. They implement the bit manipulation built-ins with shifts and masks when LLVM
+// intrinsics cannot be used (e.g. with the C backend), and work on both scalar and vector
+// (simd) types.
+
+static inline const thorin::Type* unsigned_type(thorin::World& world, const thorin::Type* type) {
+    auto prim_type = type->as<thorin::PrimType>();
+    switch (num_bits(prim_type->primtype_tag())) {
+        case 8:  return world.prim_type(thorin::PrimType_pu8,  prim_type->length());
+        case 16: return world.prim_type(thorin::PrimType_pu16, prim_type->length());
+        case 32: return world.prim_type(thorin::PrimType_pu32, prim_type->length());
+        case 64: return world.prim_type(thorin::PrimType_pu64, prim_type->length());
+        default:
+            assert(false);
+            return nullptr;
+    }
+}
+
+static inline const thorin::Def* uint_constant(thorin::World& world, const thorin::Type* type, uint64_t value) {
+    auto prim_type = type->as<thorin::PrimType>();
+    const thorin::Def* elem = nullptr;
+    switch (num_bits(prim_type->primtype_tag())) {
+        case 8:  elem = world.literal_pu8 (uint8_t(value),  {}); break;
+        case 16: elem = world.literal_pu16(uint16_t(value), {}); break;
+        case 32: elem = world.literal_pu32(uint32_t(value), {}); break;
+        case 64: elem = world.literal_pu64(uint64_t(value), {}); break;
+        default:
+            assert(false);
+            return nullptr;
+    }
+    if (prim_type->length() == 1)
+        return elem;
+    return world.vector(thorin::Array<const thorin::Def*>(prim_type->length(), elem));
+}
+
+static inline const thorin::Def* popcount(const thorin::Def* val) {
+    auto& world = val->world();
+    auto type = val->type();
+    auto bits = num_bits(type->as<thorin::PrimType>()->primtype_tag());
+    auto constant = [&] (uint64_t value) { return uint_constant(world, type, value); };
+    // Parallel bit count, recognized as `ctpop` by LLVM
+    val = world.arithop_sub(val, world.arithop_and(world.arithop_shr(val, constant(1)), constant(0x5555555555555555)));
+    val = world.arithop_add(
+        world.arithop_and(val, constant(0x3333333333333333)),
+        world.arithop_and(world.arithop_shr(val, constant(2)), constant(0x3333333333333333)));
+    val = world.arithop_and(world.arithop_add(val, world.arithop_shr(val, constant(4))), constant(0x0F0F0F0F0F0F0F0F));
+    if (bits > 8)
+        val = world.arithop_shr(world.arithop_mul(val, constant(0x0101010101010101)), constant(bits - 8));
+    return val;
+}
+
+static inline const thorin::Def* clz(const thorin::Def* val) {
+    auto& world = val->world();
+    auto bits = num_bits(val->type()->as<thorin::PrimType>()->primtype_tag());
+    // Set all the bits below the most significant one, and count the remaining zeros
+    for (size_t shift = 1; shift < bits; shift *= 2)
+        val = world.arithop_or(val, world.arithop_shr(val, uint_constant(world, val->type(), shift)));
+    return popcount(world.arithop_not(val));
+}
+
+static inline const thorin::Def* ctz(const thorin::Def* val) {
+    auto& world = val->world();
+    // Count the zeros below the least significant bit that is set
+    auto below = world.arithop_sub(val, uint_constant(world, val->type(), 1));
+    return popcount(world.arithop_and(world.arithop_not(val), below));
+}
+
+static inline const thorin::Def* bswap(const thorin::Def* val) {
+    auto& world = val->world();
+    auto type = val->type();
+    auto bits = num_bits(type->as<thorin::PrimType>()->primtype_tag());
+    const thorin::Def* result = nullptr;
+    for (size_t i = 0; i < bits; i += 8) {
+        auto byte = world.arithop_and(world.arithop_shr(val, uint_constant(world, type, i)), uint_constant(world, type, 0xFF));
+        byte = world.arithop_shl(byte, uint_constant(world, type, bits - 8 - i));
+        result = result ? world.arithop_or(result, byte) : byte;
+    }
+    return result;
+}
+
+static inline const thorin::Def* rotate(const thorin::Def* val, const thorin::Def* amount, bool left) {
+    auto& world = val->world();
+    auto type = val->type();
+    auto mask = uint_constant(world, type, num_bits(type->as<thorin::PrimType>()->primtype_tag()) - 1);
+    // The amounts are masked so that no shift is larger than the width of the type
+    auto first  = world.arithop_and(amount, mask);
+    auto second = world.arithop_and(world.arithop_sub(uint_constant(world, type, 0), amount), mask);
+    return left
+        ? world.arithop_or(world.arithop_shl(val, first), world.arithop_shr(val, second))
+        : world.arithop_or(world.arithop_shr(val, first), world.arithop_shl(val, second));
+}
+
+static inline const thorin::Def* mulhi(const thorin::Def* left, const thorin::Def* right, bool is_signed) {
+    auto& world = left->world();
+    auto type = left->type()->as<thorin::PrimType>();
+    auto bits = num_bits(type->primtype_tag());
+    if (bits < 64) {
+        // Multiply in a type twice as large, and keep the upper half of the result
+        auto wide_tag = is_signed
+            ? (bits == 8 ? thorin::PrimType_qs16 : bits == 16 ? thorin::PrimType_qs32 : thorin::PrimType_qs64)
+            : (bits == 8 ? thorin::PrimType_pu16 : bits == 16 ? thorin::PrimType_pu32 : thorin::PrimType_pu64);
+        auto wide_type = world.prim_type(wide_tag, type->length());
+        auto product = world.arithop_mul(world.cast(wide_type, left), world.cast(wide_type, right));
+        return world.cast(type, world.arithop_shr(product, world.cast(wide_type, uint_constant(world, type, bits))));
+    }
+
+    // There is no 128-bit type: Combine the partial products of the 32-bit halves
+    auto uint_type = unsigned_type(world, type);
+    auto constant = [&] (uint64_t value) { return uint_constant(world, uint_type, value); };
+    auto a = world.bitcast(uint_type, left);
+    auto b = world.bitcast(uint_type, right);
+    auto a_lo = world.arithop_and(a, constant(0xFFFFFFFF)), a_hi = world.arithop_shr(a, constant(32));
+    auto b_lo = world.arithop_and(b, constant(0xFFFFFFFF)), b_hi = world.arithop_shr(b, constant(32));
+    auto lo_lo = world.arithop_mul(a_lo, b_lo);
+    auto hi_lo = world.arithop_mul(a_hi, b_lo);
+    auto lo_hi = world.arithop_mul(a_lo, b_hi);
+    auto hi_hi = world.arithop_mul(a_hi, b_hi);
+    auto cross = world.arithop_add(
+        world.arithop_add(world.arithop_shr(lo_lo, constant(32)), world.arithop_and(hi_lo, constant(0xFFFFFFFF))),
+        lo_hi);
+    auto hi = world.arithop_add(
+        world.arithop_add(world.arithop_shr(hi_lo, constant(32)), world.arithop_shr(cross, constant(32))),
+        hi_hi);
+    if (is_signed) {
+        // Subtract the other operand from the unsigned result for each negative operand
+        auto a_neg = world.arithop_sub(constant(0), world.arithop_shr(a, constant(63)));
+        auto b_neg = world.arithop_sub(constant(0), world.arithop_shr(b, constant(63)));
+        hi = world.arithop_sub(hi, world.arithop_add(world.arithop_and(a_neg, b), world.arithop_and(b_neg, a)));
+    }
+    return world.bitcast(type, hi);
+}
+
 const thorin::Def* Emitter::builtin(const ast::FnDecl& fn_decl, thorin::Continuation* cont) {
     if (cont->name() == "alignof") {
         auto target_type = fn_decl.type_params->params[0]->type->convert(*this);
@@ -905,6 +1127,18 @@ const thorin::Def* Emitter::builtin(const ast::FnDecl& fn_decl, thorin::Continua
         auto mono_type = member_type(fn_decl.fn->param->type->replace(type_vars), 1)->as<PtrType>()->pointee;
         auto ret_val = call(comparator(fn_decl.loc, mono_type), tuple_from_params(cont, true));
         jump(cont->params().back(), ret_val);
+    } else if (
+        cont->name() == "fma"      || cont->name() == "mulhi" ||
+        cont->name() == "popcount" || cont->name() == "clz"   || cont->name() == "ctz" ||
+        cont->name() == "bswap"    || cont->name() == "rotl"  || cont->name() == "rotr")
+    {
+        enter(cont);
+        auto ret_val = bit_builtin(fn_decl, cont);
+        jump(cont->params().back(), ret_val);
+    } else if (cont->name() == "prefetch" || cont->name() == "nt_store") {
+        enter(cont);
+        auto ret_val = memory_builtin(fn_decl, cont);
+        jump(cont->params().back(), ret_val);
     } else {
         static const std::unordered_map<std::string, std::function<const thorin::Def* (const thorin::Continuation*)>> functions = {
             { "fabs",     [&] (const thorin::Continuation* cont) { return world.fabs(cont->param(1)); } },
@@ -941,6 +1175,381 @@ const thorin::Def* Emitter::builtin(const ast::FnDecl& fn_decl, thorin::Continua
     return cont;
 }
 
+const thorin::Def* Emitter::bit_builtin(const ast::FnDecl& fn_decl, thorin::Continuation* cont) {
+    auto name = cont->name();
+    auto type = fn_decl.fn->type->as<FnType>()->codom->replace(type_vars);
+    auto elem_type = is_simd_type(type) ? type->as<SizedArrayType>()->elem : type;
+    if (name == "fma" ? !is_float_type(elem_type) : !is_int_type(elem_type)) {
+        error(fn_decl.loc, "built-in function '{}' cannot be used with type '{}'", name, *type);
+        return world.bottom(type->convert(*this));
+    }
+
+    if (name == "fma")
+        return fma(cont->param(1), cont->param(2), cont->param(3));
+    if (name == "mulhi") {
+        auto is_signed =
+            is_prim_type(elem_type, ast::PrimType::I8)  || is_prim_type(elem_type, ast::PrimType::I16) ||
+            is_prim_type(elem_type, ast::PrimType::I32) || is_prim_type(elem_type, ast::PrimType::I64);
+        auto type = cont->param(1)->type()->as<thorin::PrimType>();
+        if (x86_64 && type->length() == 1 && num_bits(type->primtype_tag()) == 64)
+            return x86_64_mulhi(cont->param(1), cont->param(2), is_signed);
+        return mulhi(cont->param(1), cont->param(2), is_signed);
+    }
+
+    auto val_type = cont->param(1)->type();
+    auto uint_type = unsigned_type(world, val_type);
+    auto val = world.bitcast(uint_type, cont->param(1));
+    const thorin::Def* result = nullptr;
+    if (llvm_intrinsics) {
+        auto suffix = intrinsic_suffix(uint_type, false);
+        if (name == "popcount")
+            result = call_intrinsic("llvm.ctpop." + suffix, { val }, uint_type);
+        else if (name == "clz" || name == "ctz") {
+            // The result is defined for zero, which is indicated by the second argument
+            auto intrinsic = (name == "clz" ? "llvm.ctlz." : "llvm.cttz.") + suffix;
+            result = call_intrinsic(intrinsic, { val, world.literal_bool(false, {}) }, uint_type);
+        } else if (name == "bswap") {
+            // Swapping the bytes of an 8-bit integer does not change it (and `llvm.bswap.i8` is invalid)
+            result = num_bits(uint_type->as<thorin::PrimType>()->primtype_tag()) == 8
+                ? val : call_intrinsic("llvm.bswap." + suffix, { val }, uint_type);
+        } else {
+            // Rotations are funnel shifts of a value with itself
+            auto intrinsic = (name == "rotl" ? "llvm.fshl." : "llvm.fshr.") + suffix;
+            result = call_intrinsic(intrinsic, { val, val, world.bitcast(uint_type, cont->param(2)) }, uint_type);
+        }
+    } else if (name == "popcount")
+        result = popcount(val);
+    else if (name == "clz")
+        result = clz(val);
+    else if (name == "ctz")
+        result = ctz(val);
+    else if (name == "bswap")
+        result = bswap(val);
+    else
+        result = rotate(val, world.bitcast(uint_type, cont->param(2)), name == "rotl");
+    return world.bitcast(val_type, result);
+}
+
+const thorin::Def* Emitter::memory_builtin(const ast::FnDecl& fn_decl, thorin::Continuation* cont) {
+    auto name = cont->name();
+    auto ptr = cont->param(1);
+    if (name == "prefetch")
+        prefetch(ptr, cont->param(2), cont->param(3));
+    else {
+        // Thorin cannot mark a store as non-temporal, so the instruction is written by hand
+        auto type = cont->param(2)->type()->isa<thorin::PrimType>();
+        if (!x86_64)
+            error(fn_decl.loc, "built-in function '{}' is only supported on x86-64 targets", name);
+        else if (!type || type->length() != 1 || (num_bits(type->primtype_tag()) != 32 && num_bits(type->primtype_tag()) != 64))
+            error(fn_decl.loc, "built-in function '{}' can only store 32 or 64-bit scalars", name);
+        else
+            x86_64_nt_store(ptr, cont->param(2));
+    }
+    return world.tuple({});
+}
+
+const thorin::Def* Emitter::fma(const thorin::Def* a, const thorin::Def* b, const thorin::Def* c) {
+    auto type = a->type()->as<thorin::PrimType>();
+    if (llvm_intrinsics) {
+        // The intrinsic is correctly rounded for every precision, and has vector overloads
+        return call_intrinsic("llvm.fma." + intrinsic_suffix(type, true), { a, b, c }, type);
+    }
+
+    if (type->length() > 1) {
+        thorin::Array<const thorin::Def*> lanes(type->length());
+        for (size_t i = 0, n = type->length(); i < n; ++i)
+            lanes[i] = fma(world.extract(a, i), world.extract(b, i), world.extract(c, i));
+        return world.vector(lanes);
+    }
+
+    // Thorin has no fused multiply-add: Call the C library, which backends map to the hardware
+    // instruction. Half-precision numbers go through `fmaf`, since their product is exact in `f32`,
+    // but the result is then rounded twice.
+    if (type == world.type_qf64()) {
+        auto fn = imported_fn("fma", function_type_with_mem(world.tuple_type({ type, type, type }), type), thorin::CC::C);
+        return call(fn, world.tuple({ a, b, c }));
+    }
+    auto f32_type = world.type_qf32();
+    auto fn = imported_fn("fmaf", function_type_with_mem(world.tuple_type({ f32_type, f32_type, f32_type }), f32_type), thorin::CC::C);
+    auto result = call(fn, world.tuple({ world.cast(f32_type, a), world.cast(f32_type, b), world.cast(f32_type, c) }));
+    return world.cast(type, result);
+}
+
+/// Returns the upper half of the product of two 64-bit scalars with a single `mul` or `imul`
+/// instruction. LLVM has no intrinsic for this, and Thorin has no 128-bit type to widen into.
+const thorin::Def* Emitter::x86_64_mulhi(const thorin::Def* left, const thorin::Def* right, bool is_signed) {
+    auto type = left->type();
+    auto assembly = world.assembly(
+        world.tuple_type({ world.mem_type(), type, type }),
+        std::vector<const thorin::Def*> { state.mem, left, right },
+        is_signed ? "imulq $3" : "mulq $3",
+        std::vector<std::string> { "={rdx}", "={rax}" },
+        std::vector<std::string> { "{rax}", "r" },
+        std::vector<std::string> { "flags" },
+        thorin::Assembly::Flags::NoFlag);
+    state.mem = assembly->out(0);
+    return assembly->out(1);
+}
+
+/// Stores a value with `movnti`, which writes it to memory without bringing the line into
+/// the caches. Such stores are weakly ordered: Programs that hand the data over to another
+/// thread must issue a fence (`sfence`) first.
+void Emitter::x86_64_nt_store(const thorin::Def* ptr, const thorin::Def* value) {
+    // The instruction only takes general-purpose registers, so floating-point values are stored as integers
+    auto bits = num_bits(value->type()->as<thorin::PrimType>()->primtype_tag());
+    auto int_type = bits == 64 ? world.type_pu64() : world.type_pu32();
+    auto assembly = world.assembly(
+        world.tuple_type({ world.mem_type() }),
+        std::vector<const thorin::Def*> { state.mem, ptr, world.bitcast(int_type, value) },
+        "movnti $1, ($0)",
+        std::vector<std::string> {},
+        std::vector<std::string> { "r", "r" },
+        std::vector<std::string> { "memory" },
+        thorin::Assembly::Flags::HasSideEffects);
+    state.mem = assembly->out(0);
+}
+
+const thorin::Def* Emitter::call_intrinsic(
+    const std::string& name,
+    const std::vector<const thorin::Def*>& args,
+    const thorin::Type* ret_type)
+{
+    assert(llvm_intrinsics);
+    thorin::Array<const thorin::Type*> arg_types(args.size());
+    for (size_t i = 0, n = args.size(); i < n; ++i)
+        arg_types[i] = args[i]->type();
+    auto fn = imported_fn(name, function_type_with_mem(world.tuple_type(arg_types), ret_type), thorin::CC::Device);
+    return call(fn, world.tuple(args));
+}
+
+void Emitter::prefetch(const thorin::Def* ptr, const thorin::Def* rw, const thorin::Def* locality) {
+    if (!llvm_intrinsics)
+        return;
+    // The intrinsic is overloaded on the address space of the pointer (pointers are opaque in LLVM)
+    auto addr_space = ptr->type()->as<thorin::PtrType>()->addr_space();
+    auto ptr_type = world.ptr_type(world.type_pu8(), 1, -1, addr_space);
+    // The access type and locality are immediates, which is checked by the type checker,
+    // and the last argument selects the data cache
+    call_intrinsic(
+        "llvm.prefetch.p" + std::to_string(static_cast<int>(addr_space)),
+        { world.bitcast(ptr_type, ptr), rw, locality, world.literal_qs32(1, {}) },
+        world.tuple_type({}));
+}
+
+thorin::Continuation* Emitter::imported_fn(const std::string& name, const thorin::FnType* type, thorin::CC cc) {
+    if (auto it = imported_fns.find(name); it != imported_fns.end())
+        return it->second;
+    auto cont = world.continuation(type, thorin::Debug(name));
+    cont->attributes().cc = cc;
+    world.make_external(cont);
+    return imported_fns[name] = cont;
+}
+
+void Emitter::dispatcher(thorin::Continuation* cont, const std::vector<std::string>& features) {
+    auto _ = save_state();
+    auto name = cont->name();
+    auto dispatcher = world.continuation(cont->type(), thorin::Debug(name));
+    dispatcher->params().back()->set_name("ret");
+    world.make_external(dispatcher);
+    cont->set_name(name + ".default");
+
+    // Calls the given function with the parameters of the dispatcher
+    auto forward = [&] (const thorin::Def* callee) {
+        thorin::Array<const thorin::Def*> args(dispatcher->num_params());
+        args[0] = state.mem;
+        for (size_t i = 1, n = args.size(); i < n; ++i)
+            args[i] = dispatcher->param(i);
+        state.cont->jump(callee, args);
+        state.cont = nullptr;
+    };
+
+    enter(dispatcher);
+    auto detected = call(cpu_features(), world.tuple({}));
+    // The last feature is expected to be the most specific one, so it is tried first
+    for (auto it = features.rbegin(); it != features.rend(); ++it) {
+        if (std::find(clone_features.begin(), clone_features.end(), *it) == clone_features.end())
+            clone_features.push_back(*it);
+        auto bit = world.literal_pu32(uint32_t(1) << find_cpu_feature(*it), {});
+        auto branch_true  = basic_block_with_mem(thorin::Debug("has_" + *it));
+        auto branch_false = basic_block_with_mem();
+        branch_with_mem(world.cmp_ne(world.arithop_and(detected, bit), world.literal_pu32(0, {})), branch_true, branch_false);
+        enter(branch_true);
+        forward(imported_fn(name + "." + *it, cont->type(), thorin::CC::C));
+        enter(branch_false);
+    }
+    forward(cont);
+}
+
+/// Clones are emitted in other modules (see `target_clone`), which have their own copy of every
+/// static variable. Cloned functions must therefore not reach mutable statics, since the clones
+/// would not share them with the rest of the program.
+void Emitter::check_clones() {
+    for (auto fn_decl : cloned_fns) {
+        std::unordered_set<const ast::NamedDecl*> visited;
+        std::vector<const ast::NamedDecl*> stack { fn_decl };
+        while (!stack.empty()) {
+            auto decl = stack.back();
+            stack.pop_back();
+            if (!visited.insert(decl).second)
+                continue;
+            if (auto static_decl = decl->isa<ast::StaticDecl>(); static_decl && static_decl->is_mut) {
+                error(fn_decl->attrs->find("target_clones")->loc,
+                    "function '{}' cannot be cloned, since it uses the mutable static variable '{}'",
+                    fn_decl->id.name, static_decl->id.name);
+                note(static_decl->loc, "static variable declared here");
+                break;
+            }
+            if (auto it = fn_refs.find(decl->isa<ast::FnDecl>()); it != fn_refs.end())
+                stack.insert(stack.end(), it->second.rbegin(), it->second.rend());
+        }
+    }
+}
+
+thorin::Continuation* Emitter::cpu_features() {
+    if (cpu_features_fn)
+        return cpu_features_fn;
+
+    auto _ = save_state();
+    auto u32_type = world.type_pu32();
+    auto zero = world.literal_pu32(0, {});
+    auto has_bit = [&] (const thorin::Def* value, uint32_t mask) {
+        return world.cmp_eq(world.arithop_and(value, world.literal_pu32(mask, {})), world.literal_pu32(mask, {}));
+    };
+    cpu_features_fn = world.continuation(
+        function_type_with_mem(world.tuple_type({}), u32_type),
+        thorin::Debug("cpu_features"));
+    auto ret = cpu_features_fn->params().back();
+    enter(cpu_features_fn);
+
+    // Detection only runs once: The highest bit of the cached value indicates whether it is valid
+    auto valid_bit = uint32_t(1) << 31;
+    auto cache = world.global(zero, true, thorin::Debug("cpu_features_cache"));
+    auto cached = load(cache);
+    auto detect = basic_block_with_mem(thorin::Debug("detect"));
+    auto done = basic_block_with_mem(thorin::Debug("done"));
+    branch_with_mem(has_bit(cached, valid_bit), done, detect);
+    enter(done);
+    jump(ret, cached);
+
+    enter(detect);
+    auto max_leaf = cpuid(0)[0];
+    auto leaf1 = cpuid(1);
+    auto leaf7 = cpuid(7);
+    // Leaves above the maximum return the contents of the highest leaf
+    auto has_leaf7 = world.cmp_ge(max_leaf, world.literal_pu32(7, {}));
+    leaf7[1] = world.select(has_leaf7, leaf7[1], zero);
+    leaf7[2] = world.select(has_leaf7, leaf7[2], zero);
+
+    // XGETBV faults when the OS has not enabled it (OSXSAVE bit)
+    auto xgetbv = basic_block_with_mem(thorin::Debug("xgetbv"));
+    auto no_xgetbv = basic_block_with_mem(thorin::Debug("no_xgetbv"));
+    auto join = basic_block_with_mem(u32_type, thorin::Debug("join"));
+    branch_with_mem(has_bit(leaf1[2], uint32_t(1) << 27), xgetbv, no_xgetbv);
+    enter(xgetbv);
+    auto assembly = world.assembly(
+        world.tuple_type({ world.mem_type(), u32_type, u32_type }),
+        std::vector<const thorin::Def*> { state.mem, zero },
+        "xgetbv",
+        std::vector<std::string> { "={eax}", "={edx}" },
+        std::vector<std::string> { "{ecx}" },
+        std::vector<std::string> {},
+        thorin::Assembly::Flags::NoFlag);
+    state.mem = assembly->out(0);
+    jump(join, assembly->out(1));
+    enter(no_xgetbv);
+    jump(join, zero);
+
+    enter(join);
+    auto xcr0 = join->param(1);
+    const thorin::Def* features = world.literal_pu32(valid_bit, {});
+    for (size_t i = 0, n = std::size(artic::cpu_features); i < n; ++i) {
+        auto& feature = artic::cpu_features[i];
+        auto& leaf = feature.leaf == 1 ? leaf1 : leaf7;
+        auto has_feature = has_bit(leaf[feature.in_ebx ? 1 : 2], uint32_t(1) << feature.bit);
+        if (feature.xcr0_mask != 0)
+            has_feature = world.arithop_and(has_feature, has_bit(xcr0, feature.xcr0_mask));
+        features = world.arithop_or(features, world.select(has_feature, world.literal_pu32(uint32_t(1) << i, {}), zero));
+    }
+    store(cache, features);
+    jump(ret, features);
+    return cpu_features_fn;
+}
+
+std::array<const thorin::Def*, 4> Emitter::cpuid(uint32_t leaf) {
+    auto u32_type = world.type_pu32();
+    auto assembly = world.assembly(
+        world.tuple_type({ world.mem_type(), u32_type, u32_type, u32_type, u32_type }),
+        std::vector<const thorin::Def*> { state.mem, world.literal_pu32(leaf, {}), world.literal_pu32(0, {}) },
+        "cpuid",
+        std::vector<std::string> { "={eax}", "={ebx}", "={ecx}", "={edx}" },
+        std::vector<std::string> { "{eax}", "{ecx}" },
+        std::vector<std::string> {},
+        thorin::Assembly::Flags::NoFlag);
+    state.mem = assembly->out(0);
+    return { assembly->out(1), assembly->out(2), assembly->out(3), assembly->out(4) };
+}
+
+/// Calls the entry hook of the given function, and returns a continuation that calls the exit hook
+/// before jumping to the return continuation of the function. The hooks are imported functions:
+///
+///     void __artic_enter(uint32_t id);                  void __artic_exit(uint32_t id);
+///     void __artic_enter_ts(uint32_t id, uint64_t tsc); void __artic_exit_ts(uint32_t id, uint64_t tsc);
+///
+/// where `id` is the index of the function in `instrumented_fns`, and `tsc` the time-stamp counter.
+thorin::Continuation* Emitter::instrument(const ast::FnDecl& fn_decl, thorin::Continuation* cont, bool with_timestamp) {
+    auto name = fn_decl.id.name;
+    if (fn_decl.type_params) {
+        // Each instance of a polymorphic function gets its own identifier
+        for (size_t i = 0, n = fn_decl.type_params->params.size(); i < n; ++i)
+            name += (i == 0 ? "[" : ", ") + type_name(fn_decl.type_params->params[i]->type);
+        name += "]";
+    }
+    auto id = world.literal_pu32(instrumented_fns.size(), {});
+    instrumented_fns.push_back(InstrumentedFn { std::move(name), fn_decl.loc });
+
+    auto hook_type = with_timestamp
+        ? function_type_with_mem(world.tuple_type({ world.type_pu32(), world.type_pu64() }), world.tuple_type({}))
+        : function_type_with_mem(world.type_pu32(), world.tuple_type({}));
+    auto enter_hook = imported_fn(with_timestamp ? "__artic_enter_ts" : "__artic_enter", hook_type, thorin::CC::C);
+    auto exit_hook  = imported_fn(with_timestamp ? "__artic_exit_ts"  : "__artic_exit",  hook_type, thorin::CC::C);
+    auto hook_arg = [&] {
+        return with_timestamp ? world.tuple({ id, timestamp() }) : id;
+    };
+    call(enter_hook, hook_arg());
+
+    // Every exit of the function goes through this continuation, including `return` when used as a value
+    auto _ = save_state();
+    auto ret = cont->params().back();
+    auto exit_cont = world.continuation(ret->type()->as<thorin::FnType>(), thorin::Debug("instrumented_ret"));
+    enter(exit_cont);
+    call(exit_hook, hook_arg());
+    thorin::Array<const thorin::Def*> args(exit_cont->num_params());
+    args[0] = state.mem;
+    for (size_t i = 1, n = args.size(); i < n; ++i)
+        args[i] = exit_cont->param(i);
+    state.cont->jump(ret, args);
+    return exit_cont;
+}
+
+/// Reads the time-stamp counter of the processor. This is much cheaper than calling
+/// a clock function from the hooks, but is only available on x86 processors.
+const thorin::Def* Emitter::timestamp() {
+    auto u32_type = world.type_pu32();
+    auto u64_type = world.type_pu64();
+    auto assembly = world.assembly(
+        world.tuple_type({ world.mem_type(), u32_type, u32_type }),
+        std::vector<const thorin::Def*> { state.mem },
+        "rdtsc",
+        std::vector<std::string> { "={eax}", "={edx}" },
+        std::vector<std::string> {},
+        std::vector<std::string> {},
+        thorin::Assembly::Flags::HasSideEffects);
+    state.mem = assembly->out(0);
+    auto low  = world.cast(u64_type, assembly->out(1));
+    auto high = world.cast(u64_type, assembly->out(2));
+    return world.arithop_or(world.arithop_shl(high, world.literal_pu64(32, {})), low);
+}
+
 const thorin::Def* Emitter::comparator(const Loc& loc, const Type* type) {
     if (auto it = comparators.find(type); it != comparators.end())
         return it->second;
@@ -1035,6 +1644,7 @@ const thorin::Def* Emitter::comparator(const Loc& loc, const Type* type) {
             error(loc, "cannot compare values containing functions");
             break;
     }
+    ++comparator_count;
     return comparators[type] = comparator_fn;
 }
 
@@ -1050,15 +1660,41 @@ static inline thorin::Loc location(const Loc& loc) {
 }
 
 thorin::Debug Emitter::debug_info(const ast::NamedDecl& decl) {
+    // Names of declarations are always needed, as they are
+    // used for exported/imported symbols and intrinsics.
+    if (!debug)
+        return thorin::Debug(decl.id.name);
     return thorin::Debug(decl.id.name, location(decl.loc));
 }
 
 thorin::Debug Emitter::debug_info(const ast::Node& node, const std::string_view& name) {
     if (auto named_decl = node.isa<ast::NamedDecl>(); named_decl && name == "")
         return debug_info(*named_decl);
+    if (!debug)
+        return {};
     return thorin::Debug(std::string(name), location(node.loc));
 }
 
+const std::string& Emitter::type_name(const Type* type) {
+    // Type variables are resolved first: Since the types given to this function are
+    // otherwise monomorphic, their names do not depend on the current bindings.
+    if (auto type_var = type->isa<TypeVar>())
+        return type_name(type_vars[type_var]);
+    if (auto it = type_names.find(type); it != type_names.end())
+        return it->second;
+    auto name = type->stringify(*this);
+    if (name.size() > max_type_name_length) {
+        // Keep a readable prefix and append the hash of the complete name
+        static constexpr char digits[] = "0123456789abcdef";
+        size_t hash = fnv::Hash().combine(std::string_view(name));
+        name.resize(max_type_name_length - 2 - sizeof(size_t) * 2);
+        name += "_h";
+        for (size_t i = sizeof(size_t) * 2; i-- > 0;)
+            name += digits[(hash >> (i * 4)) & 0xF];
+    }
+    return type_names.emplace(type, std::move(name)).first->second;
+}
+
 namespace ast {
 
 const thorin::Def* Node::emit(Emitter&) const {
@@ -1097,13 +1733,15 @@ const thorin::Def* Path::emit(Emitter& emitter) const {
                 map.insert(emitter.type_vars.begin(), emitter.type_vars.end());
                 std::swap(map, emitter.type_vars);
             }
+            if (emitter.target_clones && emitter.state.fn_decl && (decl->isa<FnDecl>() || decl->isa<StaticDecl>()))
+                emitter.fn_refs[emitter.state.fn_decl].push_back(decl);
             auto def = emitter.emit(*decl);
             if (!elems[i].inferred_args.empty()) {
                 // Polymorphic nodes are emitted with the map from type variable
                 // to concrete type, which means that the emitted node cannot be
                 // kept around: Another instantiation may be using a different map,
                 // which would conflict with this one.
-                decl->def = nullptr;
+                emitter.def_of(*decl) = nullptr;
                 std::swap(map, emitter.type_vars);
             }
             return def;
@@ -1409,6 +2047,36 @@ const thorin::Def* WhileExpr::emit(Emitter& emitter) const {
 }
 
 const thorin::Def* ForExpr::emit(Emitter& emitter) const {
+    if (is_range()) {
+        // Counted loops are emitted directly, with the induction variable as a parameter of the loop header
+        auto from_value = emitter.emit(*from);
+        auto to_value = emitter.emit(*to);
+        auto for_head = emitter.basic_block_with_mem(from_value->type(), emitter.debug_info(*this, "for_head"));
+        auto for_body = emitter.basic_block_with_mem(emitter.debug_info(*this, "for_body"));
+        auto for_exit = emitter.basic_block_with_mem(emitter.debug_info(*this, "for_exit"));
+        auto for_continue = emitter.basic_block_with_mem(emitter.world.unit(), emitter.debug_info(*this, "for_continue"));
+        auto for_break    = emitter.basic_block_with_mem(emitter.world.unit(), emitter.debug_info(*this, "for_break"));
+        auto index = for_head->param(1);
+
+        emitter.jump(for_head, from_value);
+        emitter.enter(for_head);
+        emitter.branch_with_mem(emitter.world.cmp_lt(index, to_value), for_body, for_exit);
+        emitter.enter(for_continue);
+        emitter.jump(for_head, emitter.world.arithop_add(index, emitter.world.one(index->type())));
+        emitter.enter(for_break);
+        emitter.jump(for_exit);
+        break_ = for_break;
+        continue_ = for_continue;
+
+        emitter.enter(for_body);
+        emitter.emit(*ptrn, index);
+        emitter.emit(*body);
+        emitter.jump(for_continue);
+
+        emitter.enter(for_exit);
+        return emitter.world.tuple({});
+    }
+
     // The call has the for `(range(|i| { ... }))(0, 10)`
     auto body_fn = call->callee->as<CallExpr>()->arg->as<FnExpr>();
     thorin::Continuation* body_cont = nullptr;
@@ -1446,8 +2114,12 @@ const thorin::Def* ContinueExpr::emit(Emitter&) const {
     return loop->continue_;
 }
 
-const thorin::Def* ReturnExpr::emit(Emitter&) const {
-    return fn->def->as_nom<thorin::Continuation>()->params().back();
+const thorin::Def* ReturnExpr::emit(Emitter& emitter) const {
+    if (auto it = emitter.return_conts.find(fn); it != emitter.return_conts.end())
+        return it->second;
+    auto def = emitter.def_of(*fn);
+    assert(def && "functions are emitted before their body");
+    return def->as_nom<thorin::Continuation>()->params().back();
 }
 
 const thorin::Def* UnaryExpr::emit(Emitter& emitter) const {
@@ -1551,7 +2223,9 @@ const thorin::Def* BinaryExpr::emit(Emitter& emitter) const {
     }
     auto rhs = emitter.emit(*right);
     const thorin::Def* res = nullptr;
-    switch (remove_eq(tag)) {
+    if (emitter.state.float_rewrites && is_float_type(right->type) && remove_eq(tag) >= Add && remove_eq(tag) <= Div)
+        res = emitter.float_arithop(remove_eq(tag), lhs, rhs, emitter.debug_info(*this));
+    else switch (remove_eq(tag)) {
         case Add:   res = emitter.world.arithop_add(lhs, rhs, emitter.debug_info(*this)); break;
         case Sub:   res = emitter.world.arithop_sub(lhs, rhs, emitter.debug_info(*this)); break;
         case Mul:   res = emitter.world.arithop_mul(lhs, rhs, emitter.debug_info(*this)); break;
@@ -1662,8 +2336,10 @@ const thorin::Def* FnDecl::emit(Emitter& emitter) const {
     }
 
     auto cont = emitter.world.continuation(cont_type, emitter.debug_info(*this));
-    if (type_params)
+    if (type_params) {
         emitter.mono_fns.emplace(std::move(mono_fn), cont);
+        ++mono_fn_count;
+    }
 
     cont->params().back()->set_name("ret");
 
@@ -1672,7 +2348,26 @@ const thorin::Def* FnDecl::emit(Emitter& emitter) const {
         if (auto export_attr = attrs->find("export")) {
             if (auto name_attr = export_attr->find("name"))
                 cont->set_name(name_attr->as<LiteralAttr>()->lit.as_string());
-            emitter.world.make_external(cont);
+            std::vector<std::string> features;
+            auto clones_attr = attrs->find("target_clones");
+            if (clones_attr) {
+                for (auto& arg : clones_attr->as<NamedAttr>()->args)
+                    features.push_back(arg->as<LiteralAttr>()->lit.as_string());
+            }
+            if (!emitter.target_clone.empty()) {
+                // Modules that contain clones only export them, under the name used by the dispatcher
+                if (std::find(features.begin(), features.end(), emitter.target_clone) != features.end()) {
+                    cont->set_name(cont->name() + "." + emitter.target_clone);
+                    emitter.world.make_external(cont);
+                }
+            } else if (!features.empty() && emitter.target_clones) {
+                if (emitter.x86) {
+                    emitter.dispatcher(cont, features);
+                    emitter.cloned_fns.push_back(this);
+                } else
+                    emitter.error(clones_attr->loc, "'target_clones' is only supported on x86 targets");
+            } else
+                emitter.world.make_external(cont);
         } else if (auto import_attr = attrs->find("import")) {
             if (auto name_attr = import_attr->find("name"))
                 cont->set_name(name_attr->as<LiteralAttr>()->lit.as_string());
@@ -1695,24 +2390,58 @@ const thorin::Def* FnDecl::emit(Emitter& emitter) const {
     if (fn->body) {
         // Set the IR node before entering the body, in case
         // we encounter `return` or a recursive call.
-        fn->def = def = cont;
+        emitter.def_of(*fn) = cont;
+        emitter.def_of(*this) = cont;
+        emitter.state.fn_decl = this;
+
+        // Floating-point rewrites only apply to the body of the function
+        // that is annotated, including its anonymous functions.
+        emitter.state.float_rewrites = 0;
+        if (auto rewrites_attr = attrs ? attrs->find("float_rewrites") : nullptr) {
+            static const std::unordered_map<std::string, uint32_t> flags = {
+                { "fma",        Emitter::FuseMulAdd },
+                { "fold",       Emitter::FoldConstants },
+                { "reciprocal", Emitter::Reciprocal },
+                { "zero",       Emitter::IgnoreZeros }
+            };
+            auto& args = rewrites_attr->as<NamedAttr>()->args;
+            emitter.state.float_rewrites = args.empty() ? Emitter::AllFloatRewrites : 0;
+            for (auto& arg : args)
+                emitter.state.float_rewrites |= flags.at(arg->name);
+        }
 
         emitter.enter(cont);
         emitter.emit(*fn->param, emitter.tuple_from_params(cont, true));
         if (fn->filter)
             cont->set_filter(emitter.world.filter(thorin::Array<const thorin::Def*>(cont->num_params(), emitter.emit(*fn->filter))));
+
+        const thorin::Def* ret = cont->params().back();
+        auto instrument_attr = attrs ? attrs->find("instrument") : nullptr;
+        if (instrument_attr || emitter.instrument_functions) {
+            auto timestamp_attr = instrument_attr ? instrument_attr->find("timestamp") : nullptr;
+            bool with_timestamp = emitter.instrument_timestamps || timestamp_attr;
+            // The time-stamp counter is read with `rdtsc` (see `Emitter::timestamp()`)
+            if (timestamp_attr && !emitter.x86) {
+                emitter.error(timestamp_attr->loc, "'timestamp' instrumentation is only supported on x86 targets");
+                with_timestamp = false;
+            }
+            ret = emitter.return_conts[fn.get()] = emitter.instrument(*this, cont, with_timestamp);
+        }
+
         auto value = emitter.emit(*fn->body);
-        emitter.jump(cont->params().back(), value, emitter.debug_info(*fn->body));
+        emitter.jump(ret, value, emitter.debug_info(*fn->body));
     }
 
     // Clear the thorin IR generated for this entire function
     // if the function is polymorphic, so as to allow multiple
     // instantiations with different types.
     if (type_params) {
-        for (auto& def : emitter.poly_defs.back())
-            *def = nullptr;
+        for (auto node : emitter.poly_defs.back())
+            emitter.def_of(*node) = nullptr;
         emitter.poly_defs.pop_back();
-        fn->def = def = nullptr;
+        emitter.def_of(*fn) = nullptr;
+        emitter.def_of(*this) = nullptr;
+        emitter.return_conts.erase(fn.get());
     }
     return cont;
 }
@@ -1832,7 +2561,7 @@ std::string TupleType::stringify(Emitter& emitter) const {
         return "unit";
     std::string str = "tuple_";
     for (size_t i = 0, n = args.size(); i < n; ++i) {
-        str += args[i]->stringify(emitter);
+        str += emitter.type_name(args[i]);
         if (i != n - 1)
             str += "_";
     }
@@ -1847,7 +2576,7 @@ const thorin::Type* TupleType::convert(Emitter& emitter) const {
 }
 
 std::string SizedArrayType::stringify(Emitter& emitter) const {
-    return "array_" + std::to_string(size) + "_" + elem->stringify(emitter);
+    return "array_" + std::to_string(size) + "_" + emitter.type_name(elem);
 }
 
 const thorin::Type* SizedArrayType::convert(Emitter& emitter) const {
@@ -1857,7 +2586,7 @@ const thorin::Type* SizedArrayType::convert(Emitter& emitter) const {
 }
 
 std::string UnsizedArrayType::stringify(Emitter& emitter) const {
-    return "array_" + elem->stringify(emitter);
+    return "array_" + emitter.type_name(elem);
 }
 
 const thorin::Type* UnsizedArrayType::convert(Emitter& emitter) const {
@@ -1865,7 +2594,7 @@ const thorin::Type* UnsizedArrayType::convert(Emitter& emitter) const {
 }
 
 std::string PtrType::stringify(Emitter& emitter) const {
-    return "ptr_" + pointee->stringify(emitter);
+    return "ptr_" + emitter.type_name(pointee);
 }
 
 const thorin::Type* PtrType::convert(Emitter& emitter) const {
@@ -1873,7 +2602,7 @@ const thorin::Type* PtrType::convert(Emitter& emitter) const {
 }
 
 std::string FnType::stringify(Emitter& emitter) const {
-    return "fn_" + dom->stringify(emitter) + "_" + codom->stringify(emitter);
+    return "fn_" + emitter.type_name(dom) + "_" + emitter.type_name(codom);
 }
 
 const thorin::Type* FnType::convert(Emitter& emitter) const {
@@ -1891,7 +2620,7 @@ const thorin::Type* NoRetType::convert(Emitter& emitter) const {
 }
 
 std::string TypeVar::stringify(Emitter& emitter) const {
-    return emitter.type_vars[this]->stringify(emitter);
+    return emitter.type_name(emitter.type_vars[this]);
 }
 
 const thorin::Type* TypeVar::convert(Emitter& emitter) const {
@@ -1912,7 +2641,7 @@ inline std::string stringify_params(
 {
     auto str = prefix;
     for (size_t i = 0, n = params.size(); i < n; ++i) {
-        str += params[i]->type->stringify(emitter);
+        str += emitter.type_name(params[i]->type);
         if (i != n - 1)
             str += "_";
     }
@@ -1928,7 +2657,7 @@ std::string StructType::stringify(Emitter& emitter) const {
 const thorin::Type* StructType::convert(Emitter& emitter, const Type* parent) const {
     if (auto it = emitter.types.find(this); !type_params() && it != emitter.types.end())
         return it->second;
-    auto type = emitter.world.struct_type(stringify(emitter), decl.fields.size());
+    auto type = emitter.world.struct_type(emitter.type_name(parent), decl.fields.size());
     emitter.types[parent] = type;
     for (size_t i = 0, n = decl.fields.size(); i < n; ++i) {
         type->set(i, decl.fields[i]->ast::Node::type->convert(emitter));
@@ -1946,7 +2675,7 @@ std::string EnumType::stringify(Emitter& emitter) const {
 const thorin::Type* EnumType::convert(Emitter& emitter, const Type* parent) const {
     if (auto it = emitter.types.find(this); !decl.type_params && it != emitter.types.end())
         return it->second;
-    auto type = emitter.world.variant_type(stringify(emitter), decl.options.size());
+    auto type = emitter.world.variant_type(emitter.type_name(parent), decl.options.size());
     emitter.types[parent] = type;
     for (size_t i = 0, n = decl.options.size(); i < n; ++i) {
         type->set(i, decl.options[i]->type->convert(emitter));
@@ -1983,7 +2712,7 @@ const thorin::Type* TypeApp::convert(Emitter& emitter) const {
 
 // A read-only buffer from memory, not performing any copy.
 struct MemBuf : public std::streambuf {
-    MemBuf(const std::string& str) {
+    MemBuf(std::string_view str) {
         setg(
             const_cast<char*>(str.data()),
             const_cast<char*>(str.data()),
@@ -2011,20 +2740,23 @@ struct MemBuf : public std::streambuf {
     }
 };
 
-bool compile(
+bool check(
     const std::vector<std::string>& file_names,
-    const std::vector<std::string>& file_data,
+    SourceProvider& sources,
     bool warns_as_errors,
     bool enable_all_warns,
     ast::ModDecl& program,
-    thorin::World& world,
+    TypeTable& type_table,
     Log& log)
 {
-    assert(file_data.size() == file_names.size());
     for (size_t i = 0, n = file_names.size(); i < n; ++i) {
+        auto file_data = sources.read(file_names[i]);
+        if (!file_data)
+            return false;
+
         if (log.locator)
-            log.locator->register_file(file_names[i], file_data[i]);
-        MemBuf mem_buf(file_data[i]);
+            log.locator->register_file(file_names[i], *file_data);
+        MemBuf mem_buf(*file_data);
         std::istream is(&mem_buf);
 
         Lexer lexer(log, file_names[i], is);
@@ -2048,18 +2780,65 @@ bool compile(
     if (enable_all_warns)
         name_binder.warn_on_shadowing = true;
 
-    TypeTable type_table;
     TypeChecker type_checker(log, type_table);
     type_checker.warns_as_errors = warns_as_errors;
 
-    if (!name_binder.run(program) || !type_checker.run(program))
+    return name_binder.run(program) && type_checker.run(program);
+}
+
+bool compile(
+    const std::vector<std::string>& file_names,
+    SourceProvider& sources,
+    bool warns_as_errors,
+    bool enable_all_warns,
+    ast::ModDecl& program,
+    thorin::World& world,
+    Log& log,
+    bool debug,
+    bool llvm_intrinsics)
+{
+    TypeTable type_table;
+    if (!check(file_names, sources, warns_as_errors, enable_all_warns, program, type_table, log))
         return false;
 
     Emitter emitter(log, world);
     emitter.warns_as_errors = warns_as_errors;
+    emitter.debug = debug;
+    emitter.llvm_intrinsics = llvm_intrinsics;
     return emitter.run(program);
 }
 
+bool compile(
+    const std::vector<std::string>& file_names,
+    const std::vector<std::string>& file_data,
+    bool warns_as_errors,
+    bool enable_all_warns,
+    ast::ModDecl& program,
+    thorin::World& world,
+    Log& log,
+    bool debug,
+    bool llvm_intrinsics)
+{
+    // Files are requested exactly once and in order, which means that
+    // they can be returned by position (file names need not be unique).
+    struct MemorySourceProvider : public SourceProvider {
+        const std::vector<std::string>& file_data;
+        size_t next = 0;
+
+        MemorySourceProvider(const std::vector<std::string>& file_data)
+            : file_data(file_data)
+        {}
+
+        std::optional<std::string_view> read(const std::string&) override {
+            return file_data[next++];
+        }
+    };
+
+    assert(file_data.size() == file_names.size());
+    MemorySourceProvider sources(file_data);
+    return compile(file_names, sources, warns_as_errors, enable_all_warns, program, world, log, debug, llvm_intrinsics);
+}
+
 } // namespace artic
 
 /// Entry-point for the JIT in the runtime system
@@ -2074,5 +2853,5 @@ bool compile(
     log::Output out(error_stream, false);
     Log log(out, &locator);
     ast::ModDecl program;
-    return artic::compile(file_names, file_data, false, false, program, world, log);
+    return artic::compile(file_names, file_data, false, false, program, world, log, true, true);
 }
@@ -1,11 +1,15 @@
 #include <utility>
 #include <algorithm>
+#include <charconv>
 #include <cctype>
 
 #include "artic/lexer.h"
+#include "artic/stats.h"
 
 namespace artic {
 
+static Statistic token_count("lexer", "tokens", "Number of tokens lexed");
+
 std::unordered_map<std::string, Token::Tag> Lexer::keywords{
     std::make_pair("let",       Token::Let),
     std::make_pair("mut",       Token::Mut),
@@ -48,6 +52,7 @@ Lexer::Lexer(Log& log, const std::string& filename, std::istream& is)
 }
 
 Token Lexer::next() {
+    ++token_count;
     while (true) {
         eat_spaces();
 
@@ -65,8 +70,7 @@ Token Lexer::next() {
         if (accept('.')) {
             if (accept('.')) {
                 if (accept('.')) return Token(loc_, Token::Dots);
-                error(loc_, "unknown token '..'");
-                return Token(loc_);
+                return Token(loc_, Token::DotDot);
             }
             return Token(loc_, Token::Dot);
         }
@@ -161,7 +165,7 @@ Token Lexer::next() {
                     }
                     if (is_nl)
                         error(loc_, "multiline character literals are not allowed");
-                    return Token(loc_, str_, Literal(uint8_t(str_[1])));
+                    return Token(loc_, intern(str_), uint8_t(str_[1]));
                 }
             }
             error(loc_.at_begin().enlarge_after(), "unterminated character literal");
@@ -185,23 +189,21 @@ Token Lexer::next() {
                     break;
             }
             assert(str_.size() >= 2);
-            return Token(str_loc, str_, str_lit);
+            return Token(str_loc, intern(str_), &intern(str_lit));
         }
 
-        if (std::isdigit(peek()) || peek() == '.') {
-            auto lit = parse_literal();
-            return Token(loc_, str_, lit);
-        }
+        if (std::isdigit(peek()) || peek() == '.')
+            return parse_literal();
 
         if (std::isalpha(peek()) || peek() == '_') {
             append();
             while (std::isalnum(peek()) || peek() == '_') append();
 
-            if (str_ == "true")  return Token(loc_, str_, true);
-            if (str_ == "false") return Token(loc_, str_, false);
+            if (str_ == "true")  return Token(loc_, "true", true);
+            if (str_ == "false") return Token(loc_, "false", false);
 
             auto key_it = keywords.find(str_);
-            if (key_it == keywords.end()) return Token(loc_, str_);
+            if (key_it == keywords.end()) return Token(loc_, intern(str_));
             return Token(loc_, key_it->second);
         }
 
@@ -260,7 +262,7 @@ void Lexer::eat_comments() {
     }
 }
 
-Literal Lexer::parse_literal() {
+Token Lexer::parse_literal() {
     int base = 10;
 
     auto parse_digits = [&] {
@@ -282,8 +284,8 @@ Literal Lexer::parse_literal() {
 
     bool exp = false, fract = false;
     if (base == 10) {
-        // Parse fractional part
-        if (accept('.')) {
+        // Parse fractional part (`1..2` is a range, not the literal `1.` followed by `.2`)
+        if (peek() == '.' && stream_.peek() != '.' && accept('.')) {
             fract = true;
             parse_digits();
         }
@@ -296,17 +298,34 @@ Literal Lexer::parse_literal() {
         }
     }
 
-    // Skip prefix for strtol and friends
-    const char* digit_ptr = str_.c_str() + (base == 10 ? 0 : 2);
-    const char* last_ptr  = str_.c_str() + str_.size();
+    // Skip the prefix, if any, and decode the digits in place
+    const char* first = str_.data() + (base == 10 ? 0 : 2);
+    const char* last  = str_.data() + str_.size();
     auto invalid_digit = [=] (char c) { return c - '0' >= base; };
 
     // Check digits
-    if (base < 10 && std::find_if(digit_ptr, last_ptr, invalid_digit) != last_ptr)
+    if (base < 10 && std::find_if(first, last, invalid_digit) != last) {
         error(loc_, "invalid literal '{}'", str_);
+        return Token(loc_, intern(str_), uint64_t(0));
+    }
 
-    if (exp || fract) return Literal(double(std::strtod(digit_ptr, nullptr)));
-    return Literal(uint64_t(std::strtoull(digit_ptr, nullptr, base)));
+    if (exp || fract) {
+        double value = 0;
+        auto [ptr, ec] = std::from_chars(first, last, value);
+        if (ec == std::errc::result_out_of_range)
+            error(loc_, "floating-point literal '{}' is out of range", str_);
+        else if (ec != std::errc() || ptr != last)
+            error(loc_, "invalid literal '{}'", str_);
+        return Token(loc_, intern(str_), value);
+    }
+
+    uint64_t value = 0;
+    auto [ptr, ec] = std::from_chars(first, last, value, base);
+    if (ec == std::errc::result_out_of_range)
+        error(loc_, "integer literal '{}' does not fit in 64 bits", str_);
+    else if (ec != std::errc() || ptr != last)
+        error(loc_, "invalid literal '{}'", str_);
+    return Token(loc_, intern(str_), value);
 }
 
 void Lexer::append() {
@@ -371,6 +390,12 @@ void Lexer::append_char() {
         append();
 }
 
+const std::string& Lexer::intern(const std::string& str) {
+    if (auto it = strings_.find(str); it != strings_.end())
+        return *it;
+    return *strings_.emplace(str).first;
+}
+
 bool Lexer::accept(uint8_t c) {
     if (peek() == c) {
         assert(cur_.size == 1);
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "artic/locator.h"
 #include "artic/log.h"
 
@@ -15,7 +17,39 @@ ARTIC_GLOBAL Output out(std::cout, false);
 
 namespace artic {
 
+std::string Diagnostic::message() const {
+    std::ostringstream os;
+    log::Output msg_out(os, false);
+    format(msg_out);
+    return os.str();
+}
+
+void Log::record(Diagnostic&& diag) {
+    auto record = new Record { std::move(diag), records_.load(std::memory_order_relaxed) };
+    while (!records_.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed)) ;
+}
+
+std::vector<Diagnostic> Log::take_records() {
+    // Records are pushed at the front of the list, which is reversed here
+    std::vector<Diagnostic> records;
+    for (auto record = records_.exchange(nullptr, std::memory_order_acquire); record;) {
+        auto next = record->next;
+        records.emplace_back(std::move(record->diag));
+        delete record;
+        record = next;
+    }
+    std::reverse(records.begin(), records.end());
+    return records;
+}
+
+void Log::flush() {
+    for (auto& diag : take_records())
+        render(diag);
+    out.stream.flush();
+}
+
 void Log::print_summary() {
+    flush();
     if (errors == 0 && warns == 0)
         return;
     if (errors > 0) {
@@ -41,14 +75,44 @@ inline size_t count_digits(size_t i) {
     return n;
 }
 
-void Logger::diagnostic(const Loc& loc, log::Style style, char underline) {
-    if (!loc.file)
+void Log::render(const Diagnostic& diag) {
+    log::Style style = log::Style::Normal;
+    char underline = '^';
+    switch (diag.level) {
+        case Diagnostic::Error:
+            if (!empty_)
+                out.stream << "\n";
+            log::format(out, "{}: ", log::style("error", log::Style::Red, log::Style::Bold));
+            style = log::Style::Red;
+            empty_ = false;
+            break;
+        case Diagnostic::Warning:
+            if (!empty_)
+                out.stream << "\n";
+            log::format(out, "{}: ", log::style("warning", log::Style::Yellow, log::Style::Bold));
+            style = log::Style::Yellow;
+            empty_ = false;
+            break;
+        case Diagnostic::Note:
+            log::format(out, "{}: ", log::style("note", log::Style::Cyan, log::Style::Bold));
+            style = log::Style::Cyan;
+            underline = '-';
+            break;
+    }
+    diag.format(out);
+    out.stream << '\n';
+    if (!diag.loc.file)
         return;
-    log::format(log.out, " in {}\n", log::style(loc, log::Style::White, log::Style::Bold));
-    if (!diagnostics || !log.locator)
+    log::format(out, " in {}\n", log::style(diag.loc, log::Style::White, log::Style::Bold));
+    if (diag.show_source)
+        render_source(diag.loc, style, underline);
+}
+
+void Log::render_source(const Loc& loc, log::Style style, char underline) {
+    if (!locator)
         return;
 
-    auto loc_info = log.locator->data(*loc.file);
+    auto loc_info = locator->data(*loc.file);
     if (!loc_info || !loc_info->covers(loc))
         return;
 
@@ -61,7 +125,7 @@ void Logger::diagnostic(const Loc& loc, log::Style style, char underline) {
     auto end_line     = loc_info->at(loc.end.row, 1);
     auto end_line_loc = loc_info->at(loc.end.row, loc.end.col);
     auto end_line_end = loc_info->at(loc.end.row);
-    log::format(log.out, "{} {}\n{}{} {}{}",
+    log::format(out, "{} {}\n{}{} {}{}",
         log::fill(' ', indent),
         log::style('|', style, log::Style::Bold),
         log::fill(' ', indent - count_digits(loc.begin.row)),
@@ -71,7 +135,7 @@ void Logger::diagnostic(const Loc& loc, log::Style style, char underline) {
     );
     bool multiline = loc.begin.row != loc.end.row;
     if (multiline) {
-        log::format(log.out, "{}\n{} {}{}{}\n{}{}\n{}{} {}{}{}\n{} {}{}\n",
+        log::format(out, "{}\n{} {}{}{}\n{}{}\n{}{} {}{}{}\n{} {}{}\n",
             log::style(std::string_view(begin_line_loc, begin_line_end - begin_line_loc), style, log::Style::Bold),
             log::fill(' ', indent),
             log::style('|', style, log::Style::Bold),
@@ -89,7 +153,7 @@ void Logger::diagnostic(const Loc& loc, log::Style style, char underline) {
             log::style(log::fill(underline, loc.end.col - 1), style, log::Style::Bold)
         );
     } else {
-        log::format(log.out, "{}{}\n{} {}{}{}\n",
+        log::format(out, "{}{}\n{} {}{}{}\n",
             log::style(std::string_view(begin_line_loc, end_line_loc - begin_line_loc), style, log::Style::Bold),
             std::string_view(end_line_loc, end_line_end - end_line_loc),
             log::fill(' ', indent),
@@ -0,0 +1,768 @@
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string_view>
+#include <thread>
+
+#include "artic/lsp.h"
+#include "artic/lexer.h"
+#include "artic/parser.h"
+#include "artic/bind.h"
+#include "artic/check.h"
+#include "artic/print.h"
+
+namespace artic {
+
+// JSON ----------------------------------------------------------------------------
+
+/// Minimal JSON value, sufficient to represent the messages of the protocol.
+struct Json {
+    enum Kind { Null, Bool, Number, String, Array, Object };
+
+    Kind kind = Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<Json> elems;
+    std::vector<std::pair<std::string, Json>> members;
+
+    Json() = default;
+    Json(std::nullptr_t) {}
+    Json(bool boolean) : kind(Bool), boolean(boolean) {}
+    Json(int number) : kind(Number), number(number) {}
+    Json(double number) : kind(Number), number(number) {}
+    Json(const char* string) : kind(String), string(string) {}
+    Json(std::string&& string) : kind(String), string(std::move(string)) {}
+    Json(const std::string& string) : kind(String), string(string) {}
+
+    static Json array(std::vector<Json>&& elems) {
+        Json json;
+        json.kind = Array;
+        json.elems = std::move(elems);
+        return json;
+    }
+
+    static Json object(std::vector<std::pair<std::string, Json>>&& members) {
+        Json json;
+        json.kind = Object;
+        json.members = std::move(members);
+        return json;
+    }
+
+    bool is_null() const { return kind == Null; }
+
+    /// Returns the member with the given name, or a null value if there is none.
+    const Json& operator [] (const std::string_view& name) const {
+        static const Json null;
+        for (auto& member : members) {
+            if (member.first == name)
+                return member.second;
+        }
+        return null;
+    }
+};
+
+struct JsonParser {
+    std::string_view data;
+    size_t pos = 0;
+    bool ok = true;
+
+    JsonParser(std::string_view data)
+        : data(data)
+    {}
+
+    /// Parses a complete JSON document, or returns `std::nullopt` if it is malformed.
+    std::optional<Json> parse() {
+        auto json = parse_value(0);
+        skip_spaces();
+        if (!ok || pos != data.size())
+            return std::nullopt;
+        return json;
+    }
+
+private:
+    // Messages of the protocol are shallow: This prevents malicious inputs from overflowing the stack
+    static constexpr size_t max_depth = 256;
+
+    void skip_spaces() {
+        while (pos < data.size() && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\n' || data[pos] == '\r'))
+            pos++;
+    }
+
+    bool accept(char c) {
+        skip_spaces();
+        if (pos < data.size() && data[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool accept(const std::string_view& word) {
+        if (data.compare(pos, word.size(), word) == 0) {
+            pos += word.size();
+            return true;
+        }
+        return false;
+    }
+
+    Json fail() {
+        ok = false;
+        return Json();
+    }
+
+    Json parse_value(size_t depth) {
+        skip_spaces();
+        if (pos >= data.size() || depth > max_depth)
+            return fail();
+        switch (data[pos]) {
+            case '{': {
+                pos++;
+                auto json = Json::object({});
+                if (accept('}'))
+                    return json;
+                do {
+                    skip_spaces();
+                    if (pos >= data.size() || data[pos] != '"')
+                        return fail();
+                    auto name = parse_string();
+                    if (!accept(':'))
+                        return fail();
+                    json.members.emplace_back(std::move(name), parse_value(depth + 1));
+                } while (ok && accept(','));
+                return accept('}') ? json : fail();
+            }
+            case '[': {
+                pos++;
+                auto json = Json::array({});
+                if (accept(']'))
+                    return json;
+                do {
+                    json.elems.emplace_back(parse_value(depth + 1));
+                } while (ok && accept(','));
+                return accept(']') ? json : fail();
+            }
+            case '"':
+                return Json(parse_string());
+            default:
+                if (accept("true"))  return Json(true);
+                if (accept("false")) return Json(false);
+                if (accept("null"))  return Json();
+                return parse_number();
+        }
+    }
+
+    Json parse_number() {
+        // The data is not null-terminated, hence the copy
+        size_t end = pos;
+        while (end < data.size() && std::strchr("+-0123456789.eE", data[end]))
+            end++;
+        auto str = std::string(data.substr(pos, end - pos));
+        char* str_end = nullptr;
+        auto number = std::strtod(str.c_str(), &str_end);
+        if (str.empty() || str_end != str.c_str() + str.size())
+            return fail();
+        pos = end;
+        return Json(number);
+    }
+
+    uint32_t parse_hex4() {
+        uint32_t value = 0;
+        for (size_t i = 0; i < 4; ++i, ++pos) {
+            if (pos >= data.size() || !std::isxdigit(static_cast<unsigned char>(data[pos]))) {
+                ok = false;
+                return 0;
+            }
+            auto c = data[pos];
+            value = value * 16 + (std::isdigit(static_cast<unsigned char>(c)) ? c - '0' : (c | 0x20) - 'a' + 10);
+        }
+        return value;
+    }
+
+    static void append_utf8(std::string& str, uint32_t code) {
+        if (code < 0x80)
+            str += char(code);
+        else if (code < 0x800) {
+            str += char(0xC0 | (code >> 6));
+            str += char(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            str += char(0xE0 | (code >> 12));
+            str += char(0x80 | ((code >> 6) & 0x3F));
+            str += char(0x80 | (code & 0x3F));
+        } else {
+            str += char(0xF0 | (code >> 18));
+            str += char(0x80 | ((code >> 12) & 0x3F));
+            str += char(0x80 | ((code >> 6) & 0x3F));
+            str += char(0x80 | (code & 0x3F));
+        }
+    }
+
+    std::string parse_string() {
+        std::string str;
+        pos++; // Opening quote
+        while (pos < data.size() && data[pos] != '"') {
+            if (data[pos] != '\\') {
+                str += data[pos++];
+                continue;
+            }
+            if (++pos >= data.size())
+                break;
+            switch (data[pos++]) {
+                case '"':  str += '"';  break;
+                case '\\': str += '\\'; break;
+                case '/':  str += '/';  break;
+                case 'b':  str += '\b'; break;
+                case 'f':  str += '\f'; break;
+                case 'n':  str += '\n'; break;
+                case 'r':  str += '\r'; break;
+                case 't':  str += '\t'; break;
+                case 'u': {
+                    auto code = parse_hex4();
+                    // Characters outside of the BMP are encoded as surrogate pairs
+                    if (code >= 0xD800 && code < 0xDC00 && accept("\\u")) {
+                        auto low = parse_hex4();
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(str, code);
+                    break;
+                }
+                default:
+                    ok = false;
+                    return str;
+            }
+        }
+        if (pos >= data.size())
+            ok = false;
+        pos++; // Closing quote
+        return str;
+    }
+};
+
+static void write_json(std::ostream& os, const Json& json) {
+    switch (json.kind) {
+        case Json::Null:   os << "null"; break;
+        case Json::Bool:   os << (json.boolean ? "true" : "false"); break;
+        case Json::Number:
+            if (json.number == std::floor(json.number) && std::fabs(json.number) < 1e15)
+                os << static_cast<int64_t>(json.number);
+            else
+                os << json.number;
+            break;
+        case Json::String:
+            os << '"';
+            for (auto c : json.string) {
+                switch (c) {
+                    case '"':  os << "\\\""; break;
+                    case '\\': os << "\\\\"; break;
+                    case '\n': os << "\\n";  break;
+                    case '\r': os << "\\r";  break;
+                    case '\t': os << "\\t";  break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20) {
+                            static const char digits[] = "0123456789abcdef";
+                            os << "\\u00" << digits[(c >> 4) & 0xF] << digits[c & 0xF];
+                        } else
+                            os << c;
+                        break;
+                }
+            }
+            os << '"';
+            break;
+        case Json::Array:
+            os << '[';
+            for (size_t i = 0, n = json.elems.size(); i < n; ++i) {
+                if (i > 0) os << ',';
+                write_json(os, json.elems[i]);
+            }
+            os << ']';
+            break;
+        case Json::Object:
+            os << '{';
+            for (size_t i = 0, n = json.members.size(); i < n; ++i) {
+                if (i > 0) os << ',';
+                write_json(os, Json(json.members[i].first));
+                os << ':';
+                write_json(os, json.members[i].second);
+            }
+            os << '}';
+            break;
+    }
+}
+
+// Transport -----------------------------------------------------------------------
+
+/// Reads the content of the next message, which is preceded by a header that gives its length.
+static bool read_message(std::istream& in, std::string& content) {
+    static constexpr std::string_view content_length = "Content-Length:";
+    std::optional<size_t> length;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty()) {
+            if (length)
+                break;
+            continue;
+        }
+        if (line.compare(0, content_length.size(), content_length) == 0)
+            length = std::strtoull(line.c_str() + content_length.size(), nullptr, 10);
+    }
+    if (!length)
+        return false;
+    content.resize(*length);
+    in.read(content.data(), *length);
+    return static_cast<size_t>(in.gcount()) == *length;
+}
+
+static void write_message(std::ostream& out, const Json& json) {
+    std::ostringstream os;
+    write_json(os, json);
+    auto content = os.str();
+    out << "Content-Length: " << content.size() << "\r\n\r\n" << content;
+    out.flush();
+}
+
+static std::string uri_to_path(const std::string& uri) {
+    static constexpr std::string_view scheme = "file://";
+    if (uri.compare(0, scheme.size(), scheme) != 0)
+        return uri;
+    std::string path;
+    for (size_t i = scheme.size(); i < uri.size(); ++i) {
+        if (uri[i] == '%' && i + 2 < uri.size()) {
+            path += static_cast<char>(std::strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        } else
+            path += uri[i];
+    }
+    // Windows paths are of the form `file:///C:/...`
+    if (path.size() > 2 && path[0] == '/' && path[2] == ':')
+        path.erase(0, 1);
+    return path;
+}
+
+static std::string path_to_uri(const std::string& path) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string uri = path.empty() || path[0] != '/' ? "file:///" : "file://";
+    for (auto c : path) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || std::strchr("/-_.~:", c))
+            uri += c == '\\' ? '/' : c;
+        else {
+            uri += '%';
+            uri += digits[(static_cast<unsigned char>(c) >> 4) & 0xF];
+            uri += digits[c & 0xF];
+        }
+    }
+    return uri;
+}
+
+static Json make_position(const Loc::Pos& pos) {
+    // Rows and columns start at 1 in the compiler, but at 0 in the protocol
+    return Json::object({
+        { "line",      std::max(pos.row - 1, 0) },
+        { "character", std::max(pos.col - 1, 0) }
+    });
+}
+
+static Json make_range(const Loc& loc) {
+    return Json::object({
+        { "start", make_position(loc.begin) },
+        { "end",   make_position(loc.end) }
+    });
+}
+
+// Server --------------------------------------------------------------------------
+
+struct Document {
+    std::string uri;
+    std::string text;
+    bool on_disk = false;
+};
+
+// Documents, indexed by path
+using Documents = std::map<std::string, Document>;
+
+/// Results of the analysis of one version of the documents.
+/// The AST must be destroyed before the types it refers to.
+struct Analysis {
+    std::unique_ptr<TypeTable> type_table = std::make_unique<TypeTable>();
+    std::unique_ptr<ast::ModDecl> program = std::make_unique<ast::ModDecl>();
+    std::vector<const ast::Node*> nodes;
+};
+
+/// Language server that keeps the AST and the types of the last analyzed version of the program in memory.
+/// Edits are analyzed in a background thread, so that requests are always answered with the last results.
+class LanguageServer {
+public:
+    LanguageServer(std::ostream& out, const std::vector<std::string>& files)
+        : out_(out), analysis_(std::make_shared<Analysis>())
+    {
+        for (auto& file : files) {
+            auto path = std::filesystem::absolute(file).string();
+            std::ifstream is(path, std::ios::binary);
+            auto& doc = docs_[path];
+            doc.uri = path_to_uri(path);
+            doc.text.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+            doc.on_disk = true;
+        }
+    }
+
+    ~LanguageServer() {
+        // Edits that have not been analyzed yet are dropped when the client did not ask for a shutdown
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            dirty_ = false;
+        }
+        stop_worker();
+    }
+
+    /// Handles a message from the client, and returns false if the server should exit.
+    bool handle(const Json&);
+    /// Reports a message that is not valid JSON to the client.
+    void invalid_message() { reply_error(Json(), -32700, "invalid message"); }
+
+    int exit_code() const { return shutdown_ ? EXIT_SUCCESS : EXIT_FAILURE; }
+
+private:
+    // Edits that follow each other within this delay are analyzed together
+    static constexpr auto debounce_delay = std::chrono::milliseconds(200);
+
+    static std::shared_ptr<const Analysis> analyze(const Documents&, std::vector<Diagnostic>&);
+    void publish_diagnostics(const Documents&, const std::vector<Diagnostic>&);
+
+    void schedule_analysis();
+    void run_worker();
+    void stop_worker();
+
+    std::shared_ptr<const Analysis> last_analysis() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return analysis_;
+    }
+
+    static const ast::Node* find_node(const Analysis&, const Json& params);
+    Json hover(const Json& params);
+    Json definition(const Json& params);
+
+    void send(const Json& json) {
+        std::lock_guard<std::mutex> lock(out_mutex_);
+        write_message(out_, json);
+    }
+
+    void reply(const Json& id, Json&& result) {
+        send(Json::object({
+            { "jsonrpc", "2.0" },
+            { "id",      id },
+            { "result",  std::move(result) }
+        }));
+    }
+
+    void reply_error(const Json& id, int code, const char* message) {
+        send(Json::object({
+            { "jsonrpc", "2.0" },
+            { "id",      id },
+            { "error",   Json::object({ { "code", code }, { "message", message } }) }
+        }));
+    }
+
+    void notify(const char* method, Json&& params) {
+        send(Json::object({
+            { "jsonrpc", "2.0" },
+            { "method",  method },
+            { "params",  std::move(params) }
+        }));
+    }
+
+    std::ostream& out_;
+    std::mutex out_mutex_;
+    bool shutdown_ = false;
+
+    // The documents are only modified by the thread that handles messages,
+    // but the worker reads them: Modifications must be done with the lock held.
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    Documents docs_;
+    std::shared_ptr<const Analysis> analysis_;
+    std::chrono::steady_clock::time_point last_change_;
+    bool dirty_ = false;
+    bool stopping_ = false;
+    std::thread worker_;
+
+    // Paths for which diagnostics have been published (only used by the worker, once started)
+    std::vector<std::string> published_;
+};
+
+bool LanguageServer::handle(const Json& msg) {
+    auto& method = msg["method"].string;
+    auto& id     = msg["id"];
+    auto& params = msg["params"];
+
+    if (method == "initialize") {
+        reply(id, Json::object({
+            { "capabilities", Json::object({
+                { "textDocumentSync", Json::object({ { "openClose", true }, { "change", 1 } }) },
+                { "hoverProvider", true },
+                { "definitionProvider", true }
+            }) },
+            { "serverInfo", Json::object({ { "name", "artic" } }) }
+        }));
+        if (!worker_.joinable() && !shutdown_) {
+            // The files given on the command line are analyzed before any request is handled
+            std::vector<Diagnostic> diags;
+            analysis_ = analyze(docs_, diags);
+            publish_diagnostics(docs_, diags);
+            worker_ = std::thread([this] { run_worker(); });
+        }
+    } else if (method == "shutdown") {
+        // Pending edits are analyzed before replying, so that the client gets their diagnostics
+        stop_worker();
+        shutdown_ = true;
+        reply(id, Json());
+    } else if (method == "exit") {
+        return false;
+    } else if (method == "textDocument/didOpen" || method == "textDocument/didChange") {
+        auto& uri = params["textDocument"]["uri"].string;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto& doc = docs_[uri_to_path(uri)];
+            doc.uri = uri;
+            if (method == "textDocument/didOpen")
+                doc.text = params["textDocument"]["text"].string;
+            else if (!params["contentChanges"].elems.empty()) {
+                // Documents are synchronized in full: The last change contains the whole text
+                doc.text = params["contentChanges"].elems.back()["text"].string;
+            }
+        }
+        schedule_analysis();
+    } else if (method == "textDocument/didClose") {
+        // Files given on the command line stay in the workspace, with their contents on disk
+        auto path = uri_to_path(params["textDocument"]["uri"].string);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (auto it = docs_.find(path); it != docs_.end()) {
+                if (it->second.on_disk) {
+                    std::ifstream is(path, std::ios::binary);
+                    it->second.text.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+                } else
+                    docs_.erase(it);
+            }
+        }
+        schedule_analysis();
+    } else if (method == "textDocument/hover") {
+        reply(id, hover(params));
+    } else if (method == "textDocument/definition") {
+        reply(id, definition(params));
+    } else if (!id.is_null()) {
+        reply_error(id, -32601, "unsupported method");
+    }
+    return true;
+}
+
+void LanguageServer::schedule_analysis() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dirty_ = true;
+    last_change_ = std::chrono::steady_clock::now();
+    changed_.notify_one();
+}
+
+void LanguageServer::run_worker() {
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [this] { return dirty_ || stopping_; });
+        // Every new edit pushes the analysis back, unless the server is stopping
+        while (dirty_ && !stopping_ && std::chrono::steady_clock::now() < last_change_ + debounce_delay)
+            changed_.wait_until(lock, last_change_ + debounce_delay);
+        if (!dirty_)
+            return;
+        dirty_ = false;
+        auto docs = docs_;
+        lock.unlock();
+
+        std::vector<Diagnostic> diags;
+        auto analysis = analyze(docs, diags);
+        lock.lock();
+        analysis_.swap(analysis);
+        lock.unlock();
+        // The previous analysis may be large: It is destroyed without holding the lock
+        analysis.reset();
+        publish_diagnostics(docs, diags);
+    }
+}
+
+void LanguageServer::stop_worker() {
+    if (!worker_.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        changed_.notify_one();
+    }
+    worker_.join();
+}
+
+std::shared_ptr<const Analysis> LanguageServer::analyze(const Documents& docs, std::vector<Diagnostic>& diags) {
+    auto analysis = std::make_shared<Analysis>();
+
+    // Diagnostics are sent to the client, and never rendered
+    std::ostringstream null_stream;
+    log::Output null_out(null_stream, false);
+    Log log(null_out);
+
+    bool parsed = true;
+    for (auto& [path, doc] : docs) {
+        size_t errors = log.errors;
+        std::istringstream is(doc.text);
+        Lexer lexer(log, path, is);
+        Parser parser(log, lexer);
+        auto module = parser.parse();
+        if (log.errors != errors)
+            parsed = false;
+        analysis->program->decls.insert(
+            analysis->program->decls.end(),
+            std::make_move_iterator(module->decls.begin()),
+            std::make_move_iterator(module->decls.end()));
+    }
+
+    // Like the compiler, binding and type-checking are only performed on programs that parse
+    if (parsed) {
+        analysis->program->set_super();
+        NameBinder name_binder(log);
+        TypeChecker type_checker(log, *analysis->type_table);
+        type_checker.checked_nodes = &analysis->nodes;
+        if (name_binder.run(*analysis->program))
+            type_checker.run(*analysis->program);
+    }
+    diags = log.take_records();
+    return analysis;
+}
+
+void LanguageServer::publish_diagnostics(const Documents& docs, const std::vector<Diagnostic>& diags) {
+    std::map<std::string, Json> by_path;
+    // Documents without diagnostics, or that have been closed, get an empty list
+    for (auto& path : published_)
+        by_path.emplace(path, Json::array({}));
+    for (auto& [path, _] : docs)
+        by_path.emplace(path, Json::array({}));
+
+    Json* last = nullptr;
+    for (auto& diag : diags) {
+        if (!diag.loc.file) {
+            // Notes without location refer to the previous diagnostic
+            if (diag.level == Diagnostic::Note && last)
+                last->members.back().second.string += "\n" + diag.message();
+            continue;
+        }
+        auto& list = by_path.emplace(*diag.loc.file, Json::array({})).first->second;
+        int severity = diag.level == Diagnostic::Error ? 1 : diag.level == Diagnostic::Warning ? 2 : 3;
+        list.elems.push_back(Json::object({
+            { "range",    make_range(diag.loc) },
+            { "severity", severity },
+            { "source",   "artic" },
+            { "message",  diag.message() }
+        }));
+        last = &list.elems.back();
+    }
+
+    published_.clear();
+    for (auto& [path, list] : by_path) {
+        auto it = docs.find(path);
+        auto uri = it != docs.end() ? it->second.uri : path_to_uri(path);
+        if (!list.elems.empty())
+            published_.push_back(path);
+        notify("textDocument/publishDiagnostics", Json::object({
+            { "uri",         std::move(uri) },
+            { "diagnostics", std::move(list) }
+        }));
+    }
+}
+
+const ast::Node* LanguageServer::find_node(const Analysis& analysis, const Json& params) {
+    auto path = uri_to_path(params["textDocument"]["uri"].string);
+    auto row = static_cast<int>(params["position"]["line"].number) + 1;
+    auto col = static_cast<int>(params["position"]["character"].number) + 1;
+    auto before = [] (int row1, int col1, int row2, int col2) {
+        return row1 < row2 || (row1 == row2 && col1 <= col2);
+    };
+
+    // The innermost node is the one that starts last, and then ends first
+    const ast::Node* found = nullptr;
+    for (auto node : analysis.nodes) {
+        auto& loc = node->loc;
+        if (!loc.file || *loc.file != path ||
+            !before(loc.begin.row, loc.begin.col, row, col) ||
+            before(loc.end.row, loc.end.col, row, col))
+            continue;
+        if (!found ||
+            !before(loc.begin.row, loc.begin.col, found->loc.begin.row, found->loc.begin.col) ||
+            (loc.begin.row == found->loc.begin.row && loc.begin.col == found->loc.begin.col &&
+             before(loc.end.row, loc.end.col, found->loc.end.row, found->loc.end.col)))
+            found = node;
+    }
+    return found;
+}
+
+Json LanguageServer::hover(const Json& params) {
+    auto analysis = last_analysis();
+    auto node = find_node(*analysis, params);
+    if (!node || !node->type)
+        return Json();
+    std::ostringstream os;
+    log::Output out(os, false);
+    Printer p(out);
+    if (auto named_decl = node->isa<ast::NamedDecl>())
+        p << named_decl->id.name << ": ";
+    node->type->print(p);
+    return Json::object({
+        { "contents", Json::object({ { "kind", "plaintext" }, { "value", os.str() } }) },
+        { "range",    make_range(node->loc) }
+    });
+}
+
+Json LanguageServer::definition(const Json& params) {
+    auto analysis = last_analysis();
+    auto node = find_node(*analysis, params);
+    if (!node)
+        return Json();
+    // Published analyses are only used by this thread, which can therefore query their type tables
+    const ast::NamedDecl* decl = nullptr;
+    if (auto path_expr = node->isa<ast::PathExpr>())
+        decl = path_decl(*analysis->type_table, path_expr->path);
+    else if (auto type_app = node->isa<ast::TypeApp>())
+        decl = path_decl(*analysis->type_table, type_app->path);
+    else
+        decl = node->isa<ast::NamedDecl>();
+    if (!decl || !decl->id.loc.file)
+        return Json();
+    auto path = *decl->id.loc.file;
+    auto it = docs_.find(path);
+    return Json::object({
+        { "uri",   it != docs_.end() ? it->second.uri : path_to_uri(path) },
+        { "range", make_range(decl->id.loc) }
+    });
+}
+
+int run_lsp_server(std::istream& in, std::ostream& out, const std::vector<std::string>& files) {
+    LanguageServer server(out, files);
+    std::string content;
+    while (read_message(in, content)) {
+        auto msg = JsonParser(content).parse();
+        if (!msg) {
+            server.invalid_message();
+            continue;
+        }
+        if (!server.handle(*msg))
+            break;
+    }
+    return server.exit_code();
+}
+
+} // namespace artic
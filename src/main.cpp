@@ -1,13 +1,20 @@
 #include <vector>
+#include <deque>
+#include <memory>
 #include <string>
 #include <streambuf>
 #include <istream>
 #include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
 
 #include "artic/log.h"
 #include "artic/print.h"
 #include "artic/emit.h"
 #include "artic/locator.h"
+#include "artic/lsp.h"
+#include "artic/stats.h"
 
 #include <thorin/world.h>
 #include <thorin/be/codegen.h>
@@ -37,6 +44,7 @@ static void usage() {
                 " -Wall   --enable-all-warnings  Enables all warnings\n"
                 " -Werror --warnings-as-errors   Treat warnings as errors\n"
                 "         --max-errors <n>       Sets the maximum number of error messages (unlimited by default)\n"
+                "         --check-only           Stops after type-checking, without generating any code\n"
                 "         --print-ast            Prints the AST after parsing and type-checking\n"
                 "         --show-implicit-casts  Shows implicit casts as comments when printing the AST\n"
                 "         --emit-thorin          Prints the Thorin IR after code generation\n"
@@ -47,6 +55,12 @@ static void usage() {
 #ifdef ENABLE_LLVM
                 "         --emit-llvm            Emits LLVM IR in the output file\n"
 #endif
+                "         --stats                Prints statistics about the compilation\n"
+                "         --stats-json <file>    Writes statistics about the compilation to a JSON file\n"
+                "         --fast-exit            Exits without releasing memory once the output files are written\n"
+                "         --instrument-functions Calls '__artic_enter(id)' and '__artic_exit(id)' in every function (see '#[instrument]')\n"
+                "         --instrument-timestamps Passes the time-stamp counter to the hooks of instrumented functions\n"
+                "         --lsp                  Runs a language server that communicates over the standard input and output\n"
                 "  -g     --debug                Enable debug information in the output file\n"
                 "  -On                           Sets the optimization level (n = 0, 1, 2, or 3, defaults to 0)\n"
                 "  -o <name>                     Sets the module name (defaults to the first file name without its extension)\n"
@@ -88,11 +102,18 @@ struct ProgramOptions {
     bool warns_as_errors = false;
     bool enable_all_warns = false;
     bool debug = false;
+    bool check_only = false;
     bool print_ast = false;
     bool emit_thorin = false;
     bool emit_c_int = false;
     bool emit_c = false;
     bool emit_llvm = false;
+    bool fast_exit = false;
+    bool instrument_functions = false;
+    bool instrument_timestamps = false;
+    bool lsp = false;
+    bool print_stats = false;
+    std::string stats_file;
     std::string host_triple;
     std::string host_cpu;
     std::string host_attr;
@@ -151,6 +172,8 @@ struct ProgramOptions {
                     }
                 } else if (matches(argv[i], "-g", "--debug")) {
                     debug = true;
+                } else if (matches(argv[i], "--check-only")) {
+                    check_only = true;
                 } else if (matches(argv[i], "--print-ast")) {
                     print_ast = true;
                 } else if (matches(argv[i], "--show-implicit-casts")) {
@@ -191,6 +214,20 @@ struct ProgramOptions {
 #endif
                 } else if (matches(argv[i], "--emit-c")) {
                     emit_c = true;
+                } else if (matches(argv[i], "--fast-exit")) {
+                    fast_exit = true;
+                } else if (matches(argv[i], "--instrument-functions")) {
+                    instrument_functions = true;
+                } else if (matches(argv[i], "--instrument-timestamps")) {
+                    instrument_timestamps = true;
+                } else if (matches(argv[i], "--lsp")) {
+                    lsp = true;
+                } else if (matches(argv[i], "--stats")) {
+                    print_stats = true;
+                } else if (matches(argv[i], "--stats-json")) {
+                    if (!check_arg(argc, argv, i))
+                        return false;
+                    stats_file = argv[++i];
                 } else if (matches(argv[i], "--host-triple")) {
                     if (!check_arg(argc, argv, i))
                         return false;
@@ -227,6 +264,10 @@ struct ProgramOptions {
                 files.push_back(argv[i]);
         }
 
+        if (check_only && (emit_thorin || emit_c_int || emit_c || emit_llvm)) {
+            log::error("option '--check-only' cannot be combined with options that generate code");
+            return false;
+        }
         return true;
     }
 };
@@ -258,6 +299,105 @@ static std::string tabs_to_spaces(const std::string& str, size_t indent) {
     return res;
 }
 
+/// Reads source files from disk, once they are requested by the compiler.
+/// Files that cannot be read are reported as errors in the log of the compiler.
+struct FileSourceProvider : public SourceProvider, public Logger {
+    // Contents of the files that have been read (a deque never moves its elements)
+    std::deque<std::string>& contents;
+    size_t tab_width;
+
+    FileSourceProvider(Log& log, std::deque<std::string>& contents, size_t tab_width)
+        : Logger(log), contents(contents), tab_width(tab_width)
+    {}
+
+    std::optional<std::string_view> read(const std::string& file_name) override {
+        auto data = read_file(file_name);
+        if (!data) {
+            error("cannot open file '{}'", file_name);
+            return std::nullopt;
+        }
+        // Tabs to spaces conversion is necessary in order to provide good error diagnostics.
+        return contents.emplace_back(tabs_to_spaces(*data, tab_width));
+    }
+};
+
+/// Returns the architecture of the target, which is the first component of its triple.
+/// Without a triple, the code is generated for the machine that runs the compiler.
+static std::string target_arch(const std::string& host_triple) {
+    if (!host_triple.empty())
+        return host_triple.substr(0, host_triple.find('-'));
+#if defined(__x86_64__) || defined(_M_X64)
+    return "x86_64";
+#elif defined(__i386__) || defined(_M_IX86)
+    return "i386";
+#else
+    return "";
+#endif
+}
+
+/// Applies the options that affect the emitted IR. The emitters of the clones are configured
+/// with this function too, so that the clones are emitted like the rest of the program.
+static void configure_emitter(Emitter& emitter, const ProgramOptions& opts) {
+    auto arch = target_arch(opts.host_triple);
+    emitter.warns_as_errors = opts.warns_as_errors;
+    emitter.debug = opts.debug || opts.emit_thorin;
+    emitter.llvm_intrinsics = !opts.emit_c;
+    emitter.x86_64 = !opts.emit_c && (arch == "x86_64" || arch == "amd64");
+    emitter.x86 = emitter.x86_64 || arch == "i386" || arch == "i486" || arch == "i586" || arch == "i686";
+    emitter.instrument_functions = opts.instrument_functions;
+    emitter.instrument_timestamps = opts.instrument_timestamps;
+    emitter.stats = opts.print_stats || !opts.stats_file.empty();
+}
+
+static Statistic opt_continuations("opt", "continuations", "Number of Thorin continuations after optimization");
+static Statistic opt_primops      ("opt", "primops",       "Number of Thorin primops after optimization");
+
+/// Records the size of the IR that remains after optimization, to be compared
+/// with the size of the IR emitted by the front-end (see `Emitter::run`).
+static void record_opt_stats(thorin::World& world) {
+    opt_continuations += world.continuations().size();
+    for (auto def : world.defs())
+        opt_primops += def->isa<thorin::PrimOp>() ? 1 : 0;
+}
+
+static void print_stats(const ProgramOptions& opts) {
+    if (opts.print_stats)
+        Statistic::print(log::err);
+    if (!opts.stats_file.empty()) {
+        std::ofstream file(opts.stats_file);
+        if (!file)
+            log::error("cannot open '{}' for writing", opts.stats_file);
+        else
+            Statistic::print_json(file);
+    }
+}
+
+/// Writes the table that maps the identifiers given to the instrumentation hooks to function names and locations.
+static void write_instrumented_fns(const std::string& name, const std::vector<Emitter::InstrumentedFn>& fns) {
+    std::ofstream file(name);
+    if (!file) {
+        log::error("cannot open '{}' for writing", name);
+        return;
+    }
+    file << "id\tname\tfile\tline\tcolumn\n";
+    for (size_t i = 0, n = fns.size(); i < n; ++i) {
+        file << i << '\t' << fns[i].name << '\t'
+             << (fns[i].loc.file ? *fns[i].loc.file : "") << '\t'
+             << fns[i].loc.begin.row << '\t' << fns[i].loc.begin.col << '\n';
+    }
+}
+
+/// Terminates the program without running any destructor. Freeing the Thorin world
+/// node by node takes a significant amount of time for large programs, and is useless
+/// when the process is about to exit anyway.
+[[noreturn]] static void fast_exit(Log& log, int status) {
+    log.flush();
+    log::out.stream.flush();
+    log::err.stream.flush();
+    std::fflush(nullptr);
+    std::_Exit(status);
+}
+
 int main(int argc, char** argv) {
     ProgramOptions opts;
     if (!opts.parse(argc, argv))
@@ -268,6 +408,10 @@ int main(int argc, char** argv) {
     if (opts.no_color)
         log::err.colorized = log::out.colorized = false;
 
+    // The language server can be started without any file, since the client opens documents
+    if (opts.lsp)
+        return run_lsp_server(std::cin, std::cout, opts.files);
+
     if (opts.files.empty()) {
         log::error("no input files");
         return EXIT_FAILURE;
@@ -276,31 +420,36 @@ int main(int argc, char** argv) {
     if (opts.module_name == "")
         opts.module_name = file_without_ext(opts.files.front());
 
+    // The locator refers to the contents of the files: they must outlive the log
+    std::deque<std::string> contents;
     Locator locator;
     Log log(log::err, &locator);
     log.max_errors = opts.max_errors;
-
-    std::vector<std::string> file_data;
-    for (auto& file : opts.files) {
-        // Tabs to spaces conversion is necessary in order to provide good error diagnostics.
-        auto data = read_file(file);
-        if (!data) {
-            log::error("cannot open file '{}'", file);
-            return EXIT_FAILURE;
-        }
-        file_data.emplace_back(tabs_to_spaces(*data, opts.tab_width));
-    }
+    FileSourceProvider sources(log, contents, opts.tab_width);
 
     thorin::World world(opts.module_name);
     world.set(opts.log_level);
     world.set(std::make_shared<thorin::Stream>(std::cerr));
 
-    ast::ModDecl program;
-    bool success = compile(
-        opts.files, file_data,
+    // The AST and its types are released as soon as they are no longer
+    // needed, so that they do not sit in memory during code generation.
+    auto type_table = std::make_unique<TypeTable>();
+    auto program = std::make_unique<ast::ModDecl>();
+    bool success = check(
+        opts.files, sources,
         opts.warns_as_errors,
         opts.enable_all_warns,
-        program, world, log);
+        *program, *type_table, log);
+    std::vector<std::string> clone_features;
+    std::vector<Emitter::InstrumentedFn> instrumented_fns;
+    if (success && !opts.check_only) {
+        Emitter emitter(log, world);
+        configure_emitter(emitter, opts);
+        emitter.target_clones = !opts.emit_c;
+        success = emitter.run(*program);
+        clone_features = std::move(emitter.clone_features);
+        instrumented_fns = std::move(emitter.instrumented_fns);
+    }
 
     log.print_summary();
 
@@ -310,13 +459,34 @@ int main(int argc, char** argv) {
         Printer p(log::out);
         p.show_implicit_casts = opts.show_implicit_casts;
         p.tab = std::string(opts.tab_width, ' ');
-        program.print(p);
+        program->print(p);
         log::out << "\n";
     }
 
     if (!success)
         return EXIT_FAILURE;
 
+    if (!instrumented_fns.empty())
+        write_instrumented_fns(opts.module_name + ".instrument.tsv", instrumented_fns);
+
+    if (opts.check_only) {
+        print_stats(opts);
+        if (opts.fast_exit)
+            fast_exit(log, EXIT_SUCCESS);
+        return EXIT_SUCCESS;
+    }
+
+    // The program is emitted again for each `#[target_clones]` feature,
+    // otherwise no front-end data is needed past this point.
+    if (!opts.emit_llvm || clone_features.empty()) {
+        program.reset();
+        type_table.reset();
+        log.flush();
+        log.locator = nullptr;
+        sources.contents.clear();
+        sources.contents.shrink_to_fit();
+    }
+
     if (opts.opt_level == 1)
         world.cleanup();
     if (opts.emit_c_int) {
@@ -329,14 +499,17 @@ int main(int argc, char** argv) {
             thorin::c::emit_c_int(world, stream);
         }
     }
-    if (opts.opt_level > 1 || opts.emit_c || opts.emit_llvm)
+    if (opts.opt_level > 1 || opts.emit_c || opts.emit_llvm) {
         world.opt();
+        if (opts.print_stats || !opts.stats_file.empty())
+            record_opt_stats(world);
+    }
     if (opts.emit_thorin)
         world.dump();
     if (opts.emit_c || opts.emit_llvm) {
         thorin::DeviceBackends backends(world, opts.opt_level, opts.debug, opts.hls_flags);
-        auto emit_to_file = [&] (thorin::CodeGen& cg) {
-            auto name = opts.module_name + cg.file_ext();
+        auto emit_to_file = [&] (thorin::CodeGen& cg, const std::string& module_name) {
+            auto name = module_name + cg.file_ext();
             std::ofstream file(name);
             if (!file)
                 log::error("cannot open '{}' for writing", name);
@@ -346,17 +519,41 @@ int main(int argc, char** argv) {
         if (opts.emit_c) {
             thorin::Cont2Config kernel_configs;
             thorin::c::CodeGen cg(world, kernel_configs, thorin::c::Lang::C99, opts.debug, opts.hls_flags);
-            emit_to_file(cg);
+            emit_to_file(cg, opts.module_name);
         }
 #ifdef ENABLE_LLVM
         if (opts.emit_llvm) {
             thorin::llvm::CPUCodeGen cg(world, opts.opt_level, opts.debug, opts.host_triple, opts.host_cpu, opts.host_attr);
-            emit_to_file(cg);
+            emit_to_file(cg, opts.module_name);
+
+            // Clones are emitted in one module per feature, which must be linked with the main one
+            for (auto& feature : clone_features) {
+                auto clone_name = opts.module_name + "." + feature;
+                thorin::World clone_world(clone_name);
+                clone_world.set(opts.log_level);
+                clone_world.set(std::make_shared<thorin::Stream>(std::cerr));
+                // The program is emitted again, so the warnings would only repeat those reported
+                // for the main module: they are dropped, but errors are still reported.
+                Log clone_log(log.out, log.locator);
+                Emitter clone_emitter(clone_log, clone_world);
+                configure_emitter(clone_emitter, opts);
+                clone_emitter.target_clone = feature;
+                if (!clone_emitter.run(*program))
+                    return EXIT_FAILURE;
+                clone_log.take_records();
+                clone_world.opt();
+                auto clone_attr = (opts.host_attr.empty() ? "" : opts.host_attr + ",") + "+" + feature;
+                thorin::llvm::CPUCodeGen clone_cg(clone_world, opts.opt_level, opts.debug, opts.host_triple, opts.host_cpu, clone_attr);
+                emit_to_file(clone_cg, clone_name);
+            }
         }
 #endif
         for (auto& cg : backends.cgs) {
-            if (cg) emit_to_file(*cg);
+            if (cg) emit_to_file(*cg, opts.module_name);
         }
     }
+    print_stats(opts);
+    if (opts.fast_exit)
+        fast_exit(log, EXIT_SUCCESS);
     return EXIT_SUCCESS;
 }
@@ -3,6 +3,7 @@
 
 #include "artic/parser.h"
 #include "artic/print.h"
+#include "artic/stack.h"
 
 namespace artic {
 
@@ -79,7 +80,7 @@ Ptr<ast::FnDecl> Parser::parse_fn_decl() {
     if (ahead().tag() == Token::LParen)
         param = parse_tuple_ptrn(true);
     else
-        error(ahead().loc(), "parameter list expected in function definition");
+        error(ahead_loc(), "parameter list expected in function definition");
 
     Ptr<ast::Type> ret_type;
     if (accept(Token::Arrow))
@@ -95,7 +96,7 @@ Ptr<ast::FnDecl> Parser::parse_fn_decl() {
 
     if (!body) {
         if (!ret_type)
-            error(ahead().loc(), "return type expected for function prototype");
+            error(ahead_loc(), "return type expected for function prototype");
         expect(Token::Semi);
     }
 
@@ -257,7 +258,7 @@ Ptr<ast::UseDecl> Parser::parse_use_decl() {
 
 Ptr<ast::ErrorDecl> Parser::parse_error_decl() {
     Tracker tracker(this);
-    error(ahead().loc(), "expected declaration, got '{}'", ahead().string());
+    error(ahead_loc(), "expected declaration, got '{}'", ahead().string());
     next();
     return make_ptr<ast::ErrorDecl>(tracker());
 }
@@ -353,7 +354,7 @@ Ptr<ast::FieldPtrn> Parser::parse_field_ptrn() {
     Ptr<ast::Ptrn> ptrn;
     if (ahead().tag() == Token::Dots) {
         id.name = "...";
-        id.loc = ahead().loc();
+        id.loc = ahead_loc();
         eat(Token::Dots);
     } else {
         id = parse_id();
@@ -412,7 +413,7 @@ Ptr<ast::ArrayPtrn> Parser::parse_array_ptrn() {
 
 Ptr<ast::ErrorPtrn> Parser::parse_error_ptrn() {
     Tracker tracker(this);
-    error(ahead().loc(), "expected pattern, got '{}'", ahead().string());
+    error(ahead_loc(), "expected pattern, got '{}'", ahead().string());
     next();
     return make_ptr<ast::ErrorPtrn>(tracker());
 }
@@ -450,7 +451,7 @@ Ptr<ast::ExprStmt> Parser::parse_expr_stmt() {
 // Expressions ---------------------------------------------------------------------
 
 Ptr<ast::Expr> Parser::parse_expr(bool allow_structs) {
-    return parse_binary_expr(allow_structs, ast::BinaryExpr::max_precedence());
+    return ensure_stack([&] { return parse_binary_expr(allow_structs, ast::BinaryExpr::max_precedence()); });
 }
 
 Ptr<ast::Expr> Parser::parse_typed_expr(Ptr<ast::Expr>&& expr) {
@@ -583,7 +584,7 @@ Ptr<ast::BlockExpr> Parser::parse_block_expr() {
             case Token::Let:
             case Token::Fn:
                 if (!last_semi && !stmts.empty() && stmts.back()->needs_semicolon())
-                    error(ahead().loc(), "expected ';', but got '{}'", ahead().string());
+                    error(ahead_loc(), "expected ';', but got '{}'", ahead().string());
                 last_semi = false;
                 stmts.emplace_back(parse_stmt());
                 continue;
@@ -645,7 +646,7 @@ Ptr<ast::CallExpr> Parser::parse_call_expr(Ptr<ast::Expr>&& callee) {
 Ptr<ast::ProjExpr> Parser::parse_proj_expr(Ptr<ast::Expr>&& expr) {
     Tracker tracker(this, expr->loc);
     eat(Token::Dot);
-    if (ahead().is_literal() && ahead().literal().is_integer()) {
+    if (ahead().is_integer_literal()) {
         size_t index = ahead().literal().as_integer();
         eat(Token::Lit);
         return make_ptr<ast::ProjExpr>(tracker(), std::move(expr), index);
@@ -729,6 +730,7 @@ Ptr<ast::Expr> Parser::parse_for_expr() {
     // Accept `for fun() { ... }`
     Ptr<ast::Ptrn> ptrn;
     if (ahead(1).tag() == Token::In ||
+        ahead(1).tag() == Token::Mut ||
         ahead(1).tag() == Token::LParen ||
         ahead(2).tag() == Token::In ||
         ahead(2).tag() == Token::Mut ||
@@ -741,10 +743,20 @@ Ptr<ast::Expr> Parser::parse_for_expr() {
     }
 
     auto expr = parse_expr();
+    if (accept(Token::DotDot)) {
+        auto to = parse_expr(false);
+        Ptr<ast::Expr> body;
+        if (ahead().tag() == Token::LBrace)
+            body = parse_block_expr();
+        else
+            body = parse_error_expr();
+        return make_ptr<ast::ForExpr>(tracker(), std::move(ptrn), std::move(expr), std::move(to), std::move(body));
+    }
+
     auto call_loc = expr->loc;
     Ptr<ast::CallExpr> call(expr->isa<ast::CallExpr>() ? expr.release()->as<ast::CallExpr>() : nullptr);
     if (!call) {
-        error(ahead().loc(), "invalid for loop expression");
+        error(ahead_loc(), "invalid for loop expression");
         return make_ptr<ast::ErrorExpr>(tracker());
     }
 
@@ -960,7 +972,7 @@ parse_opts:
     goto done;
 
 error:
-    error(ahead().loc(), "expected ':', or ')' in assembly expression");
+    error(ahead_loc(), "expected ':', or ')' in assembly expression");
 
 done:
     return make_ptr<ast::AsmExpr>(
@@ -971,7 +983,7 @@ done:
 
 Ptr<ast::ErrorExpr> Parser::parse_error_expr() {
     Tracker tracker(this);
-    error(ahead().loc(), "expected expression, got '{}'", ahead().string());
+    error(ahead_loc(), "expected expression, got '{}'", ahead().string());
     next();
     return make_ptr<ast::ErrorExpr>(tracker());
 }
@@ -1076,7 +1088,7 @@ Ptr<ast::TypeApp> Parser::parse_type_app() {
 
 Ptr<ast::ErrorType> Parser::parse_error_type() {
     Tracker tracker(this);
-    error(ahead().loc(), "expected type, got '{}'", ahead().string());
+    error(ahead_loc(), "expected type, got '{}'", ahead().string());
     next();
     return make_ptr<ast::ErrorType>(tracker());
 }
@@ -1105,6 +1117,12 @@ Ptr<ast::AttrList> Parser::parse_attr_list() {
 
 Ptr<ast::Attr> Parser::parse_attr() {
     Tracker tracker(this);
+    if (ahead().tag() == Token::Lit) {
+        auto lit = ahead().literal();
+        eat(Token::Lit);
+        return make_ptr<ast::LiteralAttr>(tracker(), std::string(), lit);
+    }
+
     std::string name;
     if (ahead().tag() == Token::Id)
         name = ahead().identifier();
@@ -1119,7 +1137,7 @@ Ptr<ast::Attr> Parser::parse_attr() {
             auto path = parse_path();
             return make_ptr<ast::PathAttr>(tracker(), std::move(name), std::move(path));
         } else {
-            error(ahead().loc(), "expected attribute value, got '{}'", ahead().string());
+            error(ahead_loc(), "expected attribute value, got '{}'", ahead().string());
             return make_ptr<ast::NamedAttr>(tracker(), std::move(name), PtrVector<ast::Attr>());
         }
     } else {
@@ -1156,7 +1174,7 @@ ast::Path Parser::parse_path(ast::Identifier&& id, bool allow_types) {
 }
 
 ast::Identifier Parser::parse_path_elem() {
-    auto prev_loc = ahead().loc();
+    auto prev_loc = ahead_loc();
     return accept(Token::Super) ? ast::Identifier(prev_loc, "super") : parse_id();
 }
 
@@ -1166,7 +1184,7 @@ ast::Identifier Parser::parse_id() {
     if (ahead().is_identifier())
         ident = ahead().identifier();
     else
-        error(ahead().loc(), "expected identifier, got '{}'", ahead().string());
+        error(ahead_loc(), "expected identifier, got '{}'", ahead().string());
     next();
     return ast::Identifier(tracker(), std::move(ident));
 }
@@ -1183,7 +1201,7 @@ ast::AsmExpr::Constr Parser::parse_constr() {
 Literal Parser::parse_lit() {
     Literal lit;
     if (!ahead().is_literal())
-        error(ahead().loc(), "expected literal, got '{}'", ahead().string());
+        error(ahead_loc(), "expected literal, got '{}'", ahead().string());
     else
         lit = ahead().literal();
     next();
@@ -1192,8 +1210,8 @@ Literal Parser::parse_lit() {
 
 std::string Parser::parse_str() {
     std::string str;
-    if (!ahead().is_literal() || !ahead().literal().is_string())
-        error(ahead().loc(), "expected string literal, got '{}'", ahead().string());
+    if (!ahead().is_string_literal())
+        error(ahead_loc(), "expected string literal, got '{}'", ahead().string());
     else
         str = ahead().literal().as_string();
     next();
@@ -1202,11 +1220,11 @@ std::string Parser::parse_str() {
 
 std::optional<size_t> Parser::parse_array_size() {
     std::optional<size_t> size;
-    if (ahead().is_literal() && ahead().literal().is_integer()) {
+    if (ahead().is_integer_literal()) {
         size = ahead().literal().as_integer();
         eat(Token::Lit);
     } else {
-        error(ahead().loc(), "expected integer literal as array size");
+        error(ahead_loc(), "expected integer literal as array size");
         if (ahead().tag() != Token::RBracket)
             next();
     }
@@ -1218,7 +1236,7 @@ size_t Parser::parse_addr_space() {
     expect(Token::LParen);
     Tracker tracker(this);
     size_t addr_space = 0;
-    if (ahead().is_literal() && ahead().literal().is_integer()) {
+    if (ahead().is_integer_literal()) {
         addr_space = ahead().literal().as_integer();
         next();
     } else
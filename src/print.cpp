@@ -4,6 +4,7 @@
 #include "artic/log.h"
 #include "artic/ast.h"
 #include "artic/types.h"
+#include "artic/stack.h"
 
 namespace artic {
 
@@ -18,10 +19,10 @@ void print_list(Printer& p, const S& sep, const L& list, F f) {
 template <typename E>
 void print_parens(Printer& p, const E& e) {
     if (e->is_tuple()) {
-        e->print(p);
+        ensure_stack([&] { e->print(p); });
     } else {
         p << '(';
-        e->print(p);
+        ensure_stack([&] { e->print(p); });
         p << ')';
     }
 }
@@ -63,7 +64,9 @@ void PathAttr::print(Printer& p) const {
 }
 
 void LiteralAttr::print(Printer& p) const {
-    p << name << " = " << std::showpoint << log::literal_style(lit);
+    if (!name.empty())
+        p << name << " = ";
+    p << std::showpoint << log::literal_style(lit);
 }
 
 void NamedAttr::print(Printer& p) const {
@@ -185,7 +188,7 @@ void BlockExpr::print(Printer& p) const {
         for (size_t i = 0, n = stmts.size(); i < n; i++) {
             auto& stmt = stmts[i];
             p << p.endl();
-            stmt->print(p);
+            ensure_stack([&] { stmt->print(p); });
             if ((i != n - 1 && stmt->needs_semicolon()) || (i == n - 1 && last_semi))
                 p << ';';
         }
@@ -265,6 +268,17 @@ void WhileExpr::print(Printer& p) const {
 }
 
 void ForExpr::print(Printer& p) const {
+    if (is_range()) {
+        p << log::keyword_style("for") << ' ';
+        ptrn->print(p);
+        p << ' ' << log::keyword_style("in") << ' ';
+        from->print(p);
+        p << "..";
+        to->print(p);
+        p << ' ';
+        body->print(p);
+        return;
+    }
     auto& iter = call->callee->as<ast::CallExpr>()->callee;
     auto lambda = call->callee->as<ast::CallExpr>()->arg->as<ast::FnExpr>();
     p << log::keyword_style("for") << ' ';
@@ -313,7 +327,7 @@ void BinaryExpr::print(Printer& p) const {
         if (needs_parens)
             print_parens(p, e);
         else
-            e->print(p);
+            ensure_stack([&] { e->print(p); });
     };
     print_op(left, false);
     p << " " << tag_to_string(tag) << " ";
@@ -0,0 +1,112 @@
+#if defined(__APPLE__) && !defined(_XOPEN_SOURCE)
+// Required to access the (deprecated) ucontext functions on macOS
+#define _XOPEN_SOURCE 700
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <utility>
+
+#include "artic/stack.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#define ARTIC_STACK_SEGMENTS
+#include <pthread.h>
+#include <ucontext.h>
+#endif
+
+namespace artic::stack {
+
+/// Space that must be left on the stack before descending into a node.
+static constexpr size_t red_zone = 256 * 1024;
+/// Size of the stack segments that are allocated when the stack is exhausted.
+static constexpr size_t segment_size = 16 * 1024 * 1024;
+
+// Lowest usable address of the current stack (stacks grow downwards on all supported targets).
+static thread_local uintptr_t limit = 0;
+
+static inline uintptr_t current() {
+#if defined(__GNUC__) || defined(__clang__)
+    return reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+#else
+    volatile char c = 0;
+    return reinterpret_cast<uintptr_t>(&c);
+#endif
+}
+
+static uintptr_t thread_limit() {
+#if defined(__linux__)
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        void* addr = nullptr;
+        size_t size = 0;
+        bool ok = pthread_attr_getstack(&attr, &addr, &size) == 0;
+        pthread_attr_destroy(&attr);
+        if (ok)
+            return reinterpret_cast<uintptr_t>(addr);
+    }
+#elif defined(__APPLE__)
+    auto self = pthread_self();
+    return reinterpret_cast<uintptr_t>(pthread_get_stackaddr_np(self)) - pthread_get_stacksize_np(self);
+#endif
+    // The bounds of the stack are unknown: Assume that the default size of
+    // a thread stack on most systems is left, counting from this point.
+    auto sp = current();
+    return sp > 1024 * 1024 ? sp - 1024 * 1024 : 0;
+}
+
+bool is_low() {
+    if (!limit)
+        limit = thread_limit();
+    return current() < limit + red_zone;
+}
+
+#ifdef ARTIC_STACK_SEGMENTS
+// `makecontext` can only pass integers to the entry point, hence these variables.
+static thread_local void (*entry_fn)(void*) = nullptr;
+static thread_local void* entry_data = nullptr;
+static thread_local std::exception_ptr entry_exception;
+// Segment kept after use, so that traversals that oscillate around the
+// limit of the stack do not allocate a new segment every time.
+static thread_local std::unique_ptr<char[]> spare_segment;
+
+static void entry() {
+    try {
+        entry_fn(entry_data);
+    } catch (...) {
+        entry_exception = std::current_exception();
+    }
+}
+
+void grow(void (*fn)(void*), void* data) {
+    auto segment = spare_segment ? std::move(spare_segment) : std::unique_ptr<char[]>(new char[segment_size]);
+    ucontext_t caller, callee;
+    if (getcontext(&callee) != 0) {
+        fn(data);
+        return;
+    }
+    callee.uc_stack.ss_sp   = segment.get();
+    callee.uc_stack.ss_size = segment_size;
+    callee.uc_link = &caller;
+    makecontext(&callee, entry, 0);
+
+    entry_fn   = fn;
+    entry_data = data;
+    auto old_limit = std::exchange(limit, reinterpret_cast<uintptr_t>(segment.get()));
+    swapcontext(&caller, &callee);
+    limit = old_limit;
+
+    if (!spare_segment)
+        spare_segment = std::move(segment);
+    if (auto exception = std::exchange(entry_exception, nullptr))
+        std::rethrow_exception(exception);
+}
+#else
+void grow(void (*fn)(void*), void* data) {
+    fn(data);
+}
+#endif
+
+} // namespace artic::stack
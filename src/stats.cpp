@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include "artic/stats.h"
+
+namespace artic {
+
+// Statistics are registered during static initialization, so the registry must be
+// constructed on first use (the order in which translation units are initialized is unspecified).
+static std::vector<const Statistic*>& registry() {
+    static std::vector<const Statistic*> stats;
+    return stats;
+}
+
+static std::mutex& registry_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+Statistic::Statistic(const char* group, const char* name, const char* desc)
+    : group(group), name(name), desc(desc)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    registry().push_back(this);
+}
+
+std::vector<const Statistic*> Statistic::all() {
+    std::vector<const Statistic*> stats;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        stats = registry();
+    }
+    std::sort(stats.begin(), stats.end(), [] (const Statistic* left, const Statistic* right) {
+        auto cmp = std::strcmp(left->group, right->group);
+        return cmp != 0 ? cmp < 0 : std::strcmp(left->name, right->name) < 0;
+    });
+    return stats;
+}
+
+void Statistic::print(log::Output& out) {
+    auto stats = all();
+    stats.erase(std::remove_if(stats.begin(), stats.end(), [] (auto stat) { return stat->value() == 0; }), stats.end());
+
+    size_t value_width = 0, name_width = 0;
+    for (auto stat : stats) {
+        value_width = std::max(value_width, std::to_string(stat->value()).size());
+        name_width  = std::max(name_width, std::strlen(stat->group) + 1 + std::strlen(stat->name));
+    }
+
+    out << log::style("statistics", log::Style::White, log::Style::Bold) << ":\n";
+    for (auto stat : stats) {
+        auto value = std::to_string(stat->value());
+        auto name  = std::string(stat->group) + "." + stat->name;
+        out << log::fill(' ', value_width - value.size()) << value << "  "
+            << name << log::fill(' ', name_width - name.size()) << "  "
+            << stat->desc << "\n";
+    }
+}
+
+void Statistic::print_json(std::ostream& os) {
+    auto stats = all();
+    os << "{\n";
+    for (size_t i = 0, n = stats.size(); i < n; ++i) {
+        os << "    \"" << stats[i]->group << "." << stats[i]->name << "\": " << stats[i]->value()
+           << (i + 1 < n ? ",\n" : "\n");
+    }
+    os << "}\n";
+}
+
+} // namespace artic
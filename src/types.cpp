@@ -2,9 +2,34 @@
 #include <algorithm>
 
 #include "artic/types.h"
+#include "artic/stats.h"
 
 namespace artic {
 
+static Statistic subtype_queries("types", "subtype_queries", "Number of subtyping queries");
+static Statistic table_load     ("types", "load_factor",     "Load factor of the type table (in percent)");
+static Statistic prim_types     ("types", "prim",            "Number of primitive types in the type table");
+static Statistic tuple_types    ("types", "tuple",           "Number of tuple types in the type table");
+static Statistic array_types    ("types", "array",           "Number of array types in the type table");
+static Statistic addr_types     ("types", "addr",            "Number of pointer and reference types in the type table");
+static Statistic fn_types       ("types", "fn",              "Number of function types in the type table");
+static Statistic type_vars      ("types", "var",             "Number of type variables in the type table");
+static Statistic poly_types     ("types", "poly",            "Number of polymorphic and user types in the type table");
+static Statistic type_apps      ("types", "app",             "Number of type applications in the type table");
+static Statistic misc_types     ("types", "misc",            "Number of other types in the type table");
+
+static Statistic& type_class_stat(const Type* type) {
+    if (type->isa<PrimType>())  return prim_types;
+    if (type->isa<TupleType>()) return tuple_types;
+    if (type->isa<ArrayType>()) return array_types;
+    if (type->isa<AddrType>())  return addr_types;
+    if (type->isa<FnType>())    return fn_types;
+    if (type->isa<TypeVar>())   return type_vars;
+    if (type->isa<PolyType>())  return poly_types;
+    if (type->isa<TypeApp>())   return type_apps;
+    return misc_types;
+}
+
 // Type Bounds ---------------------------------------------------------------------
 
 TypeBounds& TypeBounds::meet(const TypeBounds& bounds) {
@@ -83,14 +108,14 @@ size_t PrimType::hash() const {
 size_t TupleType::hash() const {
     auto h = fnv::Hash().combine(typeid(*this).hash_code());
     for (auto a : args)
-        h.combine(a);
+        h.combine(a->id);
     return h;
 }
 
 size_t SizedArrayType::hash() const {
     return fnv::Hash()
         .combine(typeid(*this).hash_code())
-        .combine(elem)
+        .combine(elem->id)
         .combine(size)
         .combine(is_simd);
 }
@@ -98,21 +123,21 @@ size_t SizedArrayType::hash() const {
 size_t UnsizedArrayType::hash() const {
     return fnv::Hash()
         .combine(typeid(*this).hash_code())
-        .combine(elem);
+        .combine(elem->id);
 }
 
 size_t AddrType::hash() const {
     return fnv::Hash()
         .combine(typeid(*this).hash_code())
-        .combine(pointee)
+        .combine(pointee->id)
         .combine(is_mut);
 }
 
 size_t FnType::hash() const {
     return fnv::Hash()
         .combine(typeid(*this).hash_code())
-        .combine(dom)
-        .combine(codom);
+        .combine(dom->id)
+        .combine(codom->id);
 }
 
 size_t BottomType::hash() const {
@@ -124,9 +149,9 @@ size_t TopType::hash() const {
 }
 
 size_t TypeApp::hash() const {
-    auto h = fnv::Hash().combine(typeid(*this).hash_code()).combine(applied);
+    auto h = fnv::Hash().combine(typeid(*this).hash_code()).combine(applied->id);
     for (auto a : type_args)
-        h.combine(a);
+        h.combine(a->id);
     return h;
 }
 
@@ -376,11 +401,22 @@ bool TypeApp::is_sized(std::unordered_set<const Type*>& seen) const {
 // Complex Types -------------------------------------------------------------------
 
 std::optional<size_t> ComplexType::find_member(const std::string_view& name) const {
-    for (size_t i = 0, n = member_count(); i < n; ++i) {
-        if (member_name(i) == name)
-            return std::make_optional(i);
+    auto n = member_count();
+    if (n < min_indexed_members()) {
+        for (size_t i = 0; i < n; ++i) {
+            if (member_name(i) == name)
+                return std::make_optional(i);
+        }
+        return std::nullopt;
+    }
+    if (!member_index_) {
+        // Member names refer to the AST, which outlives types
+        member_index_ = std::make_unique<std::unordered_map<std::string_view, size_t>>(n);
+        for (size_t i = 0; i < n; ++i)
+            member_index_->emplace(member_name(i), i);
     }
-    return std::nullopt;
+    auto it = member_index_->find(name);
+    return it != member_index_->end() ? std::make_optional(it->second) : std::nullopt;
 }
 
 const ast::TypeParamList* StructType::type_params() const {
@@ -443,6 +479,7 @@ const ModType::Members& ModType::members() const {
 // Misc. ---------------------------------------------------------------------------
 
 bool Type::subtype(const Type* other) const {
+    ++subtype_queries;
     if (this == other || isa<BottomType>() || other->isa<TopType>())
         return true;
 
@@ -691,7 +728,11 @@ const T* TypeTable::insert(Args&&... args) {
     T t(*this, std::forward<Args>(args)...);
     if (auto it = types_.find(&t); it != types_.end())
         return (*it)->template as<T>();
-    auto [it, _] = types_.emplace(new T(std::move(t)));
+    auto type = new T(std::move(t));
+    type->id = types_.size();
+    auto [it, _] = types_.emplace(type);
+    ++type_class_stat(*it);
+    table_load.set(static_cast<uint64_t>(types_.load_factor() * 100));
     return (*it)->template as<T>();
 }
 
@@ -0,0 +1,34 @@
+# Checks the table of instrumented functions TEST_TABLE, written by the compiler for TEST_SOURCE_FILE.
+# TEST_EXPECTED lists the functions that the table must contain, as `name@line@column` separated by `|`.
+# Identifiers must be consecutive, but the order of the functions is not checked.
+file(STRINGS ${TEST_TABLE} rows)
+list(LENGTH rows row_count)
+if (row_count EQUAL 0)
+    message(FATAL_ERROR "The table \"${TEST_TABLE}\" is empty")
+endif ()
+list(GET rows 0 header)
+if (NOT header STREQUAL "id\tname\tfile\tline\tcolumn")
+    message(FATAL_ERROR "Invalid header in \"${TEST_TABLE}\": ${header}")
+endif ()
+list(REMOVE_AT rows 0)
+
+string(REPLACE "|" ";" expected "${TEST_EXPECTED}")
+set(id 0)
+foreach (row ${rows})
+    if (NOT row MATCHES "^${id}\t([^\t]+)\t([^\t]*)\t([0-9]+)\t([0-9]+)$")
+        message(FATAL_ERROR "Invalid row for identifier ${id} in \"${TEST_TABLE}\": ${row}")
+    endif ()
+    if (NOT CMAKE_MATCH_2 STREQUAL TEST_SOURCE_FILE)
+        message(FATAL_ERROR "Invalid file for identifier ${id} in \"${TEST_TABLE}\": ${CMAKE_MATCH_2}")
+    endif ()
+    set(function "${CMAKE_MATCH_1}@${CMAKE_MATCH_3}@${CMAKE_MATCH_4}")
+    list(FIND expected "${function}" index)
+    if (index EQUAL -1)
+        message(FATAL_ERROR "Unexpected function for identifier ${id} in \"${TEST_TABLE}\": ${function}")
+    endif ()
+    list(REMOVE_AT expected ${index})
+    math(EXPR id "${id} + 1")
+endforeach ()
+if (NOT expected STREQUAL "")
+    message(FATAL_ERROR "Missing functions in \"${TEST_TABLE}\": ${expected}")
+endif ()
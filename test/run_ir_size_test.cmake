@@ -0,0 +1,53 @@
+# Compares the size of the IR generated for a program with the baseline recorded for it, and fails if
+# one of the tracked quantities grew by more than TEST_THRESHOLD percent. Tests are only registered for programs
+# that have a baseline, unless TEST_UPDATE is set: Baselines are then recorded, and must be added to the repository.
+set(tracked_stats emit.continuations emit.primops emit.types opt.continuations opt.primops)
+
+execute_process(
+    COMMAND ${TEST_EXECUTABLE} -O2 --stats-json ${TEST_NAME}.json ${TEST_SOURCE_FILE}
+    OUTPUT_QUIET ERROR_QUIET
+    RESULT_VARIABLE status)
+if (NOT status STREQUAL "0")
+    message(FATAL_ERROR "Error compiling \"${TEST_SOURCE_FILE}\": ${status}")
+endif ()
+file(READ ${TEST_NAME}.json stats)
+
+set(entries "")
+foreach (stat ${tracked_stats})
+    string(REPLACE "." "\\." stat_regex ${stat})
+    if (NOT stats MATCHES "\"${stat_regex}\": ([0-9]+)")
+        message(FATAL_ERROR "Statistic '${stat}' is missing from the output of the compiler")
+    endif ()
+    set(value_${stat} ${CMAKE_MATCH_1})
+    list(APPEND entries "    \"${stat}\": ${CMAKE_MATCH_1}")
+endforeach ()
+list(JOIN entries ",\n" measured)
+set(measured "{\n${measured}\n}\n")
+
+if (TEST_UPDATE)
+    file(WRITE ${TEST_BASELINE} "${measured}")
+    message(STATUS "Recorded IR size baseline in \"${TEST_BASELINE}\"")
+    return()
+endif ()
+if (NOT EXISTS ${TEST_BASELINE})
+    message(FATAL_ERROR "No IR size baseline for \"${TEST_SOURCE_FILE}\": Configure with -DARTIC_UPDATE_IR_SIZE=ON to record it in \"${TEST_BASELINE}\"")
+endif ()
+
+file(READ ${TEST_BASELINE} baseline)
+set(regressions "")
+foreach (stat ${tracked_stats})
+    string(REPLACE "." "\\." stat_regex ${stat})
+    if (NOT baseline MATCHES "\"${stat_regex}\": ([0-9]+)")
+        message(FATAL_ERROR "Statistic '${stat}' is missing from the baseline \"${TEST_BASELINE}\"")
+    endif ()
+    set(expected ${CMAKE_MATCH_1})
+    math(EXPR limit "${expected} + (${expected} * ${TEST_THRESHOLD}) / 100")
+    if (value_${stat} GREATER limit)
+        string(APPEND regressions "\n  ${stat}: ${value_${stat}} (baseline: ${expected}, limit: ${limit})")
+    elseif (value_${stat} LESS expected)
+        message(STATUS "${stat} went down from ${expected} to ${value_${stat}}, the baseline can be updated")
+    endif ()
+endforeach ()
+if (NOT regressions STREQUAL "")
+    message(FATAL_ERROR "The IR generated for \"${TEST_SOURCE_FILE}\" grew by more than ${TEST_THRESHOLD}%:${regressions}")
+endif ()
@@ -0,0 +1,69 @@
+# Runs a scripted session with the language server, with TEST_SOURCE_FILE as the workspace, and checks its replies.
+# The session is sent at once: Requests are answered with the analysis of the workspace performed on initialization,
+# and the diagnostics of the opened document are published when the client asks for a shutdown.
+# Requests cannot contain semicolons, since they are stored in a list.
+set(source_uri "file://${TEST_SOURCE_FILE}")
+if (NOT TEST_SOURCE_FILE MATCHES "^/")
+    set(source_uri "file:///${TEST_SOURCE_FILE}")
+endif ()
+string(REPLACE " " "%20" source_uri "${source_uri}")
+set(error_uri "file:///lsp_error.art")
+
+set(requests
+    [=[{"jsonrpc":"2.0","id":1,"method":"initialize","params":{}}]=]
+    [=[{"jsonrpc":"2.0","method":"initialized","params":{}}]=]
+    [=[{"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"@error_uri@","languageId":"artic","version":1,"text":"fn g() -> i32 { true }\n"}}}]=]
+    [=[{"jsonrpc":"2.0","id":2,"method":"textDocument/hover","params":{"textDocument":{"uri":"@source_uri@"},"position":{"line":6,"character":18}}}]=]
+    [=[{"jsonrpc":"2.0","id":3,"method":"textDocument/definition","params":{"textDocument":{"uri":"@source_uri@"},"position":{"line":6,"character":18}}}]=]
+    [=[{"jsonrpc":"2.0","id":4,"method":"shutdown"}]=]
+    [=[{"jsonrpc":"2.0","method":"exit"}]=])
+set(session "")
+foreach (request ${requests})
+    string(CONFIGURE "${request}" request @ONLY)
+    string(LENGTH "${request}" length)
+    string(APPEND session "Content-Length: ${length}\r\n\r\n${request}")
+endforeach ()
+file(WRITE lsp_session.in "${session}")
+
+execute_process(
+    COMMAND ${TEST_EXECUTABLE} --lsp ${TEST_SOURCE_FILE}
+    INPUT_FILE lsp_session.in
+    OUTPUT_FILE lsp_session.out
+    RESULT_VARIABLE status)
+if (NOT status STREQUAL "0")
+    message(FATAL_ERROR "The language server exited with status ${status}")
+endif ()
+# Every reply must be preceded by a header that gives its exact length. Headers are checked on the bytes
+# of the output, since CMake drops carriage returns when reading files (and the output of processes) as text.
+file(READ lsp_session.out bytes HEX)
+set(count 0)
+while (NOT bytes STREQUAL "")
+    # "Content-Length: <length>\r\n\r\n", in hexadecimal
+    if (NOT bytes MATCHES "^436f6e74656e742d4c656e6774683a20((3[0-9])+)0d0a0d0a")
+        message(FATAL_ERROR "Invalid header after reply ${count} in the output of the language server")
+    endif ()
+    string(LENGTH "${CMAKE_MATCH_0}" header_length)
+    string(REGEX REPLACE "3([0-9])" "\\1" length ${CMAKE_MATCH_1})
+    math(EXPR end "${header_length} + 2 * ${length}")
+    string(LENGTH "${bytes}" bytes_length)
+    if (bytes_length LESS end)
+        message(FATAL_ERROR "Truncated reply after reply ${count} in the output of the language server")
+    endif ()
+    string(SUBSTRING "${bytes}" ${end} -1 bytes)
+    math(EXPR count "${count} + 1")
+endwhile ()
+
+file(READ lsp_session.out replies)
+function(expect_reply expected)
+    string(CONFIGURE "${expected}" expected @ONLY)
+    string(FIND "${replies}" "${expected}" pos)
+    if (pos EQUAL -1)
+        message(FATAL_ERROR "Missing reply from the language server:\n${expected}\nReplies:\n${replies}")
+    endif ()
+endfunction()
+expect_reply([=[{"jsonrpc":"2.0","id":1,"result":{"capabilities":{"textDocumentSync":{"openClose":true,"change":1},"hoverProvider":true,"definitionProvider":true}]=])
+expect_reply([=[{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":"@source_uri@","diagnostics":[]}}]=])
+expect_reply([=[{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":"@error_uri@","diagnostics":[{"range":{"start":{"line":0,"character":16},"end":{"line":0,"character":20}},"severity":1]=])
+expect_reply([=[{"jsonrpc":"2.0","id":2,"result":{"contents":{"kind":"plaintext","value":"fn (i32) -> i32"},"range":{"start":{"line":6,"character":12},"end":{"line":6,"character":19}}}}]=])
+expect_reply([=[{"jsonrpc":"2.0","id":3,"result":{"uri":"@source_uri@","range":{"start":{"line":2,"character":11},"end":{"line":2,"character":12}}}}]=])
+expect_reply([=[{"jsonrpc":"2.0","id":4,"result":null}]=])